@@ -17,7 +17,7 @@ case "$ARCH" in
         CC="gcc"
         AS="as"
         LD="ld"
-        CFLAGS="-m32 -ffreestanding -fno-stack-protector -fno-pie -I src/kernel -I src/graphics -I src/gui"
+        CFLAGS="-m32 -msse2 -ffreestanding -fno-stack-protector -fno-pie -I src/kernel -I src/graphics -I src/gui"
         ASFLAGS="--32"
         LDFLAGS="-m elf_i386"
         LINKER_SCRIPT="linker.ld"
@@ -99,6 +99,17 @@ if [ "$ARCH" = "x86_32" ]; then
     fi
 fi
 
+# Font tables are generated from fonts/; the checked-in copy is used when
+# Python is not installed
+if command -v python3 &> /dev/null; then
+    echo "Generating font tables..."
+    python3 tools/fontgen.py -o src/graphics/font_atlas.c font_5x7=fonts/flux-5x7.bdf
+    if [ $? -ne 0 ]; then
+        echo "ERROR: Font table generation failed."
+        exit 1
+    fi
+fi
+
 # Kernel compilation
 echo "Compiling kernel..."
 $CC $CFLAGS $INCLUDE_DIRS -c $KERNEL_SRC -o kernel.o 2>&1
@@ -110,12 +121,48 @@ fi
 # Architecture-specific compilation
 case "$ARCH" in
     x86_32)
+        echo "Compiling display driver..."
+        $CC $CFLAGS -c src/kernel/bga.c -o bga.o 2>&1
+        if [ $? -ne 0 ]; then
+            echo "ERROR: BGA driver compilation failed."
+            exit 1
+        fi
+        
+        echo "Compiling clock..."
+        $CC $CFLAGS -c src/kernel/clock.c -o clock.o 2>&1
+        if [ $? -ne 0 ]; then
+            echo "ERROR: Clock compilation failed."
+            exit 1
+        fi
+        
+        echo "Compiling interrupts..."
+        $CC $CFLAGS -c src/kernel/irq.c -o irq.o 2>&1
+        if [ $? -ne 0 ]; then
+            echo "ERROR: Interrupt code compilation failed."
+            exit 1
+        fi
+        
         echo "Compiling graphics..."
         $CC $CFLAGS -c src/graphics/gfx.c -o gfx.o 2>&1
         if [ $? -ne 0 ]; then
             echo "ERROR: Graphics compilation failed."
             exit 1
         fi
+        $CC $CFLAGS -c src/graphics/span.c -o gfx_span.o 2>&1
+        if [ $? -ne 0 ]; then
+            echo "ERROR: Span kernel compilation failed."
+            exit 1
+        fi
+        $CC $CFLAGS -c src/graphics/region.c -o gfx_region.o 2>&1
+        if [ $? -ne 0 ]; then
+            echo "ERROR: Region library compilation failed."
+            exit 1
+        fi
+        $CC $CFLAGS -c src/graphics/font_atlas.c -o gfx_font.o 2>&1
+        if [ $? -ne 0 ]; then
+            echo "ERROR: Font table compilation failed."
+            exit 1
+        fi
 
         echo "Compiling GUI..."
         $CC $CFLAGS -c src/gui/desktop.c -o gui_desktop.o 2>&1
@@ -124,8 +171,10 @@ case "$ARCH" in
         $CC $CFLAGS -c src/gui/window.c -o gui_window.o 2>&1
         $CC $CFLAGS -c src/gui/button.c -o gui_button.o 2>&1
         $CC $CFLAGS -c src/gui/string.c -o gui_string.o 2>&1
+        $CC $CFLAGS -c src/gui/hud.c -o gui_hud.o 2>&1
+        $CC $CFLAGS -c src/gui/panel.c -o gui_panel.o 2>&1
         
-        OBJECTS="boot.o kernel.o gfx.o gui_desktop.o gui_mouse.o gui_keyboard.o gui_window.o gui_button.o gui_string.o libc_compat.o"
+        OBJECTS="boot.o kernel.o bga.o clock.o irq.o gfx.o gfx_span.o gfx_region.o gfx_font.o gui_desktop.o gui_mouse.o gui_keyboard.o gui_window.o gui_button.o gui_string.o gui_hud.o gui_panel.o libc_compat.o"
         ;;
     aarch64)
         echo "Compiling arch-specific drivers..."
@@ -141,6 +190,9 @@ case "$ARCH" in
         
         echo "Compiling graphics..."
         $CC $CFLAGS -I src/graphics -I src/gui -c src/graphics/gfx.c -o gfx.o 2>&1
+        $CC $CFLAGS -I src/graphics -I src/gui -c src/graphics/span.c -o gfx_span.o 2>&1
+        $CC $CFLAGS -I src/graphics -I src/gui -c src/graphics/region.c -o gfx_region.o 2>&1
+        $CC $CFLAGS -I src/graphics -I src/gui -c src/graphics/font_atlas.c -o gfx_font.o 2>&1
         
         echo "Compiling GUI..."
         $CC $CFLAGS -I src/graphics -I src/gui -c src/gui/desktop.c -o gui_desktop.o 2>&1
@@ -150,8 +202,10 @@ case "$ARCH" in
         $CC $CFLAGS -I src/graphics -I src/gui -c src/gui/window.c -o gui_window.o 2>&1
         $CC $CFLAGS -I src/graphics -I src/gui -c src/gui/button.c -o gui_button.o 2>&1
         $CC $CFLAGS -I src/graphics -I src/gui -c src/gui/string.c -o gui_string.o 2>&1
+        $CC $CFLAGS -I src/graphics -I src/gui -c src/gui/hud.c -o gui_hud.o 2>&1
+        $CC $CFLAGS -I src/graphics -I src/gui -c src/gui/panel.c -o gui_panel.o 2>&1
         
-        OBJECTS="boot.o kernel.o mailbox.o fb.o timer.o gic.o mmu.o input.o libc_compat.o gfx.o gui_desktop.o gui_window.o gui_button.o gui_string.o"
+        OBJECTS="boot.o kernel.o mailbox.o fb.o timer.o gic.o mmu.o input.o libc_compat.o gfx.o gfx_span.o gfx_region.o gfx_font.o gui_desktop.o gui_window.o gui_button.o gui_string.o gui_hud.o gui_panel.o"
         ;;
 esac
 
@@ -30,3 +30,12 @@ void fb_clear(uint32_t color) {
     }
 }
 
+/* Start of a page (screen-sized slice) of the virtual framebuffer */
+void *fb_page(int page) {
+    return (void *)(uintptr_t)(g_fb.base + (uint64_t)page * g_fb.height * g_fb.pitch);
+}
+
+/* Make a page the one being scanned out */
+void fb_show_page(int page) {
+    mailbox_set_virtual_offset(0, (uint32_t)page * g_fb.height);
+}
@@ -19,5 +19,9 @@ void fb_get_info(fb_info_t *fb);
 /* Clear framebuffer */
 void fb_clear(uint32_t color);
 
+/* Page flipping between the screens stacked in the virtual framebuffer */
+void *fb_page(int page);
+void fb_show_page(int page);
+
 #endif /* FB_H */
 
@@ -91,6 +91,11 @@ static int usb_poll_input(void) {
     return 0;
 }
 
+/* Service the USB controller; called from every pass of the GUI loop */
+void input_poll(void) {
+    usb_poll_input();
+}
+
 /* Initialize input system */
 void input_init(int screen_width, int screen_height) {
     /* Initialize input state */
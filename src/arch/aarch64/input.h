@@ -10,6 +10,9 @@
 /* Initialize input system */
 void input_init(int screen_width, int screen_height);
 
+/* Poll input devices for new reports */
+void input_poll(void);
+
 /* Mouse functions */
 void input_get_mouse(int* x, int* y);
 int input_get_mouse_buttons(void);
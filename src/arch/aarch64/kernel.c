@@ -19,9 +19,9 @@
 #include "../../graphics/gfx.h"
 
 /* Architecture-specific definitions */
-/* Pi 3/4/500: UART0 at 0xFE201000 */
+/* Pi 4/500: UART0 at 0xFE201000, Pi 3: 0x3F201000 (see MMIO_BASE) */
 /* Pi 5: UART0 at 0xFE201000 (same as Pi 4) */
-#define UART0_BASE       0xFE201000
+#define UART0_BASE       (MMIO_BASE + 0x201000)
 
 /* UART registers */
 #define UART_DR          0x00
@@ -112,23 +112,54 @@ void gui_run(void) {
     while (gui.running) {
         /* Poll for input events - in a real implementation, this would 
          * be driven by interrupts from USB controller */
+        input_poll();
         
-        /* For now, simulate some basic input or wait for USB */
+        /* Turn pointer changes into events */
+        int mouse_x, mouse_y;
+        input_get_mouse(&mouse_x, &mouse_y);
+        int buttons = input_get_mouse_buttons();
+        if (mouse_x >= gui.width) mouse_x = gui.width - 1;
+        if (mouse_y >= gui.height) mouse_y = gui.height - 1;
         
-        /* Small delay to prevent CPU spinning */
-        for (volatile int i = 0; i < 100000; i++) {
-            __asm__ volatile ("nop");
+        if (mouse_x != last_mouse_x || mouse_y != last_mouse_y) {
+            /* Move the pointer layer now; windows see the event below */
+            draw_mouse_cursor(mouse_x, mouse_y);
+            
+            event.type = EVENT_MOUSE_MOVE;
+            event.mouse_x = mouse_x;
+            event.mouse_y = mouse_y;
+            gui_queue_event(&event);
+            last_mouse_x = mouse_x;
+            last_mouse_y = mouse_y;
+        }
+        
+        for (int i = 0; i < 3; i++) {
+            int was_pressed = last_buttons & (1 << i);
+            int is_pressed = buttons & (1 << i);
+            if (was_pressed == is_pressed) continue;
+            
+            event.type = is_pressed ? EVENT_MOUSE_DOWN : EVENT_MOUSE_UP;
+            event.mouse_x = mouse_x;
+            event.mouse_y = mouse_y;
+            event.mouse_button = (mouse_button_t)i;
+            gui_queue_event(&event);
+            if (!is_pressed) {
+                event.type = EVENT_MOUSE_CLICK;
+                gui_queue_event(&event);
+            }
         }
+        last_buttons = buttons;
         
         /* Process queued events */
         while (gui_poll_event(&event)) {
             gui_handle_event(&event);
         }
         
-        /* Redraw if needed */
-        if (gui.needs_redraw && gui.framebuffer) {
-            gui_redraw_all();
-        }
+        /* Draw and present everything invalidated so far, once per frame */
+        gui_frame();
+        
+        /* Sleep until the next timer event unless this pass queued work */
+        gui_idle();
     }
     
     uart_write("GUI event loop exited\r\n");
@@ -158,7 +189,8 @@ void kernel_main(void) {
     
     /* Get framebuffer from mailbox */
     uart_write("Requesting framebuffer...\r\n");
-    if (mailbox_get_fb(&fb_info) == 0) {
+    if (fb_init() == 0) {
+        fb_get_info(&fb_info);
         uart_write("Framebuffer allocated:\r\n");
         uart_write("  Width: ");
         uart_write_hex(fb_info.width);
@@ -172,6 +204,12 @@ void kernel_main(void) {
         uart_write("  Base: ");
         uart_write_hex(fb_info.base);
         uart_write("\r\n");
+        uart_write("  Pages: ");
+        uart_write_hex(fb_info.pages);
+        uart_write("\r\n");
+        uart_write("  Depth: ");
+        uart_write_hex(fb_info.depth);
+        uart_write("\r\n");
     } else {
         uart_write("Failed to get framebuffer!\r\n");
         /* Hang */
@@ -185,8 +223,33 @@ void kernel_main(void) {
     /* Initialize GUI with framebuffer */
     if (fb_info.base != 0) {
         uart_write("Initializing GUI...\r\n");
+        
+        /* Drawing stays 32bpp XRGB; presenting packs it into this layout */
+        if (fb_info.depth == 16) {
+            gfx_set_format(GFX_FORMAT_RGB565);
+        } else if (fb_info.pixel_order == FB_PIXEL_ORDER_RGB) {
+            /* Red in the low byte: 0x00BBGGRR words */
+            gfx_set_format(GFX_FORMAT_XBGR8888);
+        } else {
+            gfx_set_format(GFX_FORMAT_XRGB8888);
+        }
         gui_init(fb_info.width, fb_info.height, (void *)fb_info.base, fb_info.pitch);
         
+        /* Render into the hidden page and flip on present */
+        if (fb_info.pages > 1) {
+            gfx_enable_page_flip(fb_page(1), fb_show_page);
+        }
+        
+        /* Full redraws mostly repaint identical pixels; only send tiles that changed */
+        gfx_set_tile_hashing(1);
+        
+        /* Pace frames off the generic timer */
+        gui_set_clock(timer_us);
+        
+        /* Sleep in WFE between passes; the timer event stream wakes it */
+        timer_events_init();
+        gui_set_idle(timer_idle);
+        
         if (gui.initialized) {
             uart_write("Creating desktop...\r\n");
             gui_create_desktop();
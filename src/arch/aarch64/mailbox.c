@@ -10,8 +10,11 @@ static volatile uint32_t *mailbox_read_reg  = (volatile uint32_t *)(MAILBOX_BASE
 static volatile uint32_t *mailbox_status_reg = (volatile uint32_t *)(MAILBOX_BASE + MAILBOX_STATUS);
 static volatile uint32_t *mailbox_write_reg  = (volatile uint32_t *)(MAILBOX_BASE + MAILBOX_WRITE);
 
-/* Mailbox buffer (in DRAM, 16-byte aligned) */
-static mailbox_buf_t mbox __attribute__((aligned(16)));
+/* Property message buffer (in DRAM, 16-byte aligned). Tags are packed
+ * back to back: tag id, value buffer size, request/response code, then
+ * the value words. */
+#define PROP_MSG_WORDS 64
+static volatile uint32_t prop_msg[PROP_MSG_WORDS] __attribute__((aligned(16)));
 
 /* Initialize mailbox */
 void mailbox_init(void) {
@@ -51,107 +54,128 @@ void mailbox_write(uint32_t channel, uint32_t data) {
     *mailbox_write_reg = (data & ~0xF) | (channel & 0xF);
 }
 
-/* Get framebuffer configuration */
-int mailbox_get_fb(fb_info_t *fb) {
-    /* Setup buffer for framebuffer request */
-    mbox.buf_size = sizeof(mbox);
-    mbox.code = 0; /* Request */
+/* Start a property message; returns the index of the first tag */
+static uint32_t prop_begin(void) {
+    return 2;
+}
+
+/* Append a tag with 'words' zeroed value words; returns the index of the
+ * first value word */
+static uint32_t prop_add_tag(uint32_t *pos, uint32_t tag, uint32_t words) {
+    prop_msg[(*pos)++] = tag;
+    prop_msg[(*pos)++] = words * 4;
+    prop_msg[(*pos)++] = 0;
+    
+    uint32_t value = *pos;
+    for (uint32_t i = 0; i < words; i++) {
+        prop_msg[(*pos)++] = 0;
+    }
+    return value;
+}
+
+/* Terminate and send the message; returns 0 if the firmware processed it */
+static int prop_call(uint32_t pos) {
+    uint32_t addr = (uint32_t)(uintptr_t)prop_msg;
     
-    /* Property tag: allocate buffer */
-    mbox.tags[0].tag = TAG_ALLOCATE_BUFFER;
-    mbox.tags[0].buf_size = 8;
-    mbox.tags[0].req_resp = 8;
-    mbox.tags[0].data[0] = 0; /* Alignment */
-    mbox.tags[0].data[1] = 0;
+    prop_msg[pos++] = 0; /* End tag */
+    prop_msg[0] = pos * 4;
+    prop_msg[1] = MAILBOX_REQUEST;
+    
+    /* Make the message visible to the VideoCore before ringing */
+    __asm__ volatile ("dsb sy" ::: "memory");
+    mailbox_write(MAILBOX_CH_PROP, addr);
+    
+    /* Wait for our response */
+    while (mailbox_read(MAILBOX_CH_PROP) != addr) {
+    }
+    __asm__ volatile ("dsb sy" ::: "memory");
+    
+    return (prop_msg[1] == MAILBOX_RESPONSE_OK) ? 0 : -1;
+}
+
+/* Get framebuffer configuration. The virtual framebuffer is FB_PAGES screens
+ * tall so the display can be flipped between them; if the firmware grants
+ * less, fb->pages reports a single page. */
+int mailbox_get_fb(fb_info_t *fb) {
+    uint32_t pos = prop_begin();
     
     /* Property tag: set physical size */
-    mbox.tags[1].tag = TAG_SET_PHY_WH;
-    mbox.tags[1].buf_size = 8;
-    mbox.tags[1].req_resp = 8;
-    mbox.tags[1].data[0] = 1920; /* Width */
-    mbox.tags[1].data[1] = 1080; /* Height */
+    uint32_t phy = prop_add_tag(&pos, TAG_SET_PHY_WH, 2);
+    prop_msg[phy] = FB_WIDTH;
+    prop_msg[phy + 1] = FB_HEIGHT;
+    
+    /* Property tag: set virtual size (stacked pages) */
+    uint32_t vir = prop_add_tag(&pos, TAG_SET_VIR_WH, 2);
+    prop_msg[vir] = FB_WIDTH;
+    prop_msg[vir + 1] = FB_HEIGHT * FB_PAGES;
+    
+    /* Property tag: show the top page */
+    prop_add_tag(&pos, TAG_SET_VIR_OFFSET, 2);
     
     /* Property tag: set depth */
-    mbox.tags[2].tag = TAG_SET_DEPTH;
-    mbox.tags[2].buf_size = 4;
-    mbox.tags[2].req_resp = 4;
-    mbox.tags[2].data[0] = 32; /* 32-bit */
+    uint32_t depth = prop_add_tag(&pos, TAG_SET_DEPTH, 1);
+    prop_msg[depth] = FB_DEPTH;
     
-    /* Property tag: get pitch */
-    mbox.tags[3].tag = TAG_GET_PITCH;
-    mbox.tags[3].buf_size = 4;
-    mbox.tags[3].req_resp = 4;
-    mbox.tags[3].data[0] = 0;
+    /* Property tag: ask for RGB order; the reply says what was granted */
+    uint32_t order = prop_add_tag(&pos, TAG_SET_PIXEL_ORDER, 1);
+    prop_msg[order] = FB_PIXEL_ORDER_RGB;
+    
+    /* Property tag: allocate buffer */
+    uint32_t alloc = prop_add_tag(&pos, TAG_ALLOCATE_BUFFER, 2);
+    prop_msg[alloc] = 16; /* Alignment */
     
-    /* End tag */
-    mbox.tags[4].tag = 0;
-    mbox.tags[4].buf_size = 0;
-    mbox.tags[4].req_resp = 0;
+    /* Property tag: get pitch */
+    uint32_t pitch = prop_add_tag(&pos, TAG_GET_PITCH, 1);
     
     /* Send to mailbox channel 8 (property tags) */
-    mailbox_write(MAILBOX_CH_PROP, (uint32_t)&mbox);
-    
-    /* Wait for response */
-    while (1) {
-        uint32_t resp = mailbox_read(MAILBOX_CH_PROP);
-        
-        /* Check if this is our response */
-        if (resp == (uint32_t)&mbox) {
-            /* Check if successful */
-            if (mbox.code == 0x80000000) {
-                /* Get framebuffer info */
-                fb->base = ((uint64_t)mbox.tags[0].data[1] << 32) | mbox.tags[0].data[0];
-                fb->size = mbox.tags[0].buf_size;
-                fb->width = mbox.tags[1].data[0];
-                fb->height = mbox.tags[1].data[1];
-                fb->depth = mbox.tags[2].data[0];
-                fb->pitch = mbox.tags[3].data[0];
-                return 0;
-            }
-            return -1;
-        }
+    if (prop_call(pos) != 0 || prop_msg[alloc] == 0) {
+        return -1;
     }
+    
+    /* Get framebuffer info; the buffer comes back as a VideoCore bus address */
+    fb->base = prop_msg[alloc] & 0x3FFFFFFF;
+    fb->size = prop_msg[alloc + 1];
+    fb->width = prop_msg[phy];
+    fb->height = prop_msg[phy + 1];
+    fb->virtual_height = prop_msg[vir + 1];
+    fb->depth = prop_msg[depth];
+    fb->pixel_order = prop_msg[order];
+    fb->pitch = prop_msg[pitch];
+    fb->pages = (fb->virtual_height >= fb->height * FB_PAGES) ? FB_PAGES : 1;
+    return 0;
 }
 
-/* Get ARM memory size */
-uint32_t mailbox_get_arm_memory(void) {
-    mbox.buf_size = sizeof(mbox);
-    mbox.code = 0;
+/* Scroll the display to (x, y) within the virtual framebuffer */
+int mailbox_set_virtual_offset(uint32_t x, uint32_t y) {
+    uint32_t pos = prop_begin();
     
-    mbox.tags[0].tag = TAG_GET_ARM_MEM;
-    mbox.tags[0].buf_size = 8;
-    mbox.tags[0].req_resp = 8;
+    uint32_t offset = prop_add_tag(&pos, TAG_SET_VIR_OFFSET, 2);
+    prop_msg[offset] = x;
+    prop_msg[offset + 1] = y;
     
-    mbox.tags[1].tag = 0;
+    /* Firmware that knows this tag returns once the new offset is latched
+     * at vertical blank; older firmware and QEMU skip it */
+    prop_add_tag(&pos, TAG_WAIT_VSYNC, 1);
     
-    mailbox_write(MAILBOX_CH_PROP, (uint32_t)&mbox);
+    return prop_call(pos);
+}
+
+/* Get ARM memory size */
+uint32_t mailbox_get_arm_memory(void) {
+    uint32_t pos = prop_begin();
+    uint32_t mem = prop_add_tag(&pos, TAG_GET_ARM_MEM, 2);
     
-    while (1) {
-        uint32_t resp = mailbox_read(MAILBOX_CH_PROP);
-        if (resp == (uint32_t)&mbox && mbox.code == 0x80000000) {
-            return mbox.tags[0].data[1];
-        }
+    while (prop_call(pos) != 0) {
     }
+    return prop_msg[mem + 1];
 }
 
 /* Get VC memory base */
 uint64_t mailbox_get_vc_memory(void) {
-    mbox.buf_size = sizeof(mbox);
-    mbox.code = 0;
-    
-    mbox.tags[0].tag = TAG_GET_VC_MEM;
-    mbox.tags[0].buf_size = 8;
-    mbox.tags[0].req_resp = 8;
+    uint32_t pos = prop_begin();
+    uint32_t mem = prop_add_tag(&pos, TAG_GET_VC_MEM, 2);
     
-    mbox.tags[1].tag = 0;
-    
-    mailbox_write(MAILBOX_CH_PROP, (uint32_t)&mbox);
-    
-    while (1) {
-        uint32_t resp = mailbox_read(MAILBOX_CH_PROP);
-        if (resp == (uint32_t)&mbox && mbox.code == 0x80000000) {
-            return ((uint64_t)mbox.tags[0].data[1] << 32) | mbox.tags[0].data[0];
-        }
+    while (prop_call(pos) != 0) {
     }
+    return prop_msg[mem];
 }
-
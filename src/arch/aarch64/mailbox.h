@@ -13,8 +13,14 @@
 #define MAILBOX_CH_PROP      8   /* Property tags channel */
 #define MAILBOX_CH_FB        1   /* Framebuffer channel */
 
+/* Peripheral window: 0xFE000000 on Pi 4/500, 0x3F000000 on Pi 3
+ * (and QEMU's raspi3 model) */
+#ifndef MMIO_BASE
+#define MMIO_BASE            0xFE000000
+#endif
+
 /* Mailbox registers */
-#define MAILBOX_BASE         0xFE00B880
+#define MAILBOX_BASE         (MMIO_BASE + 0xB880)
 #define MAILBOX_READ          0x00
 #define MAILBOX_STATUS        0x18
 #define MAILBOX_WRITE         0x20
@@ -23,6 +29,10 @@
 #define MAILBOX_FULL          0x80000000
 #define MAILBOX_EMPTY         0x40000000
 
+/* Property message codes */
+#define MAILBOX_REQUEST       0x00000000
+#define MAILBOX_RESPONSE_OK   0x80000000
+
 /* Property tags */
 #define TAG_GET_FIRMWARE      0x00000001
 #define TAG_GET_BOARD_MODEL   0x00010001
@@ -40,13 +50,29 @@
 #define TAG_GET_TEMP          0x0003000A
 #define TAG_GET_TEMP_MAX      0x0003000B
 #define TAG_ALLOCATE_BUFFER   0x00040001
+#define TAG_GET_ALPHA_MODE    0x00040007
 #define TAG_GET_PITCH         0x00040008
 #define TAG_SET_PHY_WH        0x00048003
-#define TAG_SET_VIR_WH        0x00048005
-#define TAG_SET_DEPTH         0x00048007
-#define TAG_SET_PIXEL_ORDER   0x00048009
-#define TAG_GET_ALPHA_MODE    0x0004800B
-#define TAG_SET_ALPHA_MODE    0x0004800C
+#define TAG_SET_VIR_WH        0x00048004
+#define TAG_SET_DEPTH         0x00048005
+#define TAG_SET_PIXEL_ORDER   0x00048006
+#define TAG_SET_ALPHA_MODE    0x00048007
+#define TAG_SET_VIR_OFFSET    0x00048009
+#define TAG_WAIT_VSYNC        0x0004800E
+
+/* Requested display mode; the virtual height holds FB_PAGES screens */
+#define FB_WIDTH              1920
+#define FB_HEIGHT             1080
+#define FB_PAGES              2
+
+/* Bits per pixel: 32 or 16. The palette of 8bpp modes is not loaded. */
+#ifndef FB_DEPTH
+#define FB_DEPTH              32
+#endif
+
+/* Pixel order values of TAG_SET_PIXEL_ORDER */
+#define FB_PIXEL_ORDER_BGR    0
+#define FB_PIXEL_ORDER_RGB    1
 
 /* Framebuffer info structure */
 typedef struct {
@@ -56,20 +82,11 @@ typedef struct {
     uint32_t height;
     uint32_t pitch;
     uint32_t depth;
+    uint32_t pixel_order;    /* FB_PIXEL_ORDER_* granted by the firmware */
+    uint32_t virtual_height;
+    uint32_t pages;          /* Screens that fit in the buffer (1 or 2) */
 } fb_info_t;
 
-/* Mailbox buffer structure */
-typedef struct mailbox_buf {
-    uint32_t buf_size;
-    uint32_t code;
-    struct {
-        uint32_t tag;
-        uint32_t buf_size;
-        uint32_t req_resp;
-        uint32_t data[32];
-    } tags[];
-} mailbox_buf_t;
-
 /* Initialize mailbox */
 void mailbox_init(void);
 
@@ -82,6 +99,9 @@ void mailbox_write(uint32_t channel, uint32_t data);
 /* Get framebuffer configuration */
 int mailbox_get_fb(fb_info_t *fb);
 
+/* Scroll the display to (x, y) within the virtual framebuffer */
+int mailbox_set_virtual_offset(uint32_t x, uint32_t y);
+
 /* Get ARM memory size */
 uint32_t mailbox_get_arm_memory(void);
 
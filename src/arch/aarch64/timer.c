@@ -4,24 +4,72 @@
 
 #include "timer.h"
 
-/* Timer registers */
-#define CNTPCT_EL0     ((volatile uint64_t *)0xFE00D020)
-#define CNTFRQ_EL0     ((volatile uint32_t *)0xFE00D018)
-#define CNTP_CTL_EL0   ((volatile uint32_t *)0xFE00D010)
-#define CNTP_TVAL_EL0  ((volatile uint32_t *)0xFE00D018)
-
 /* Timer frequency (set by firmware, usually 54MHz on Pi) */
 static uint32_t timer_freq = 54000000;
 
+/* The counter and its frequency are system registers, not MMIO */
+static inline uint64_t read_cntpct(void) {
+    uint64_t val;
+    __asm__ volatile ("isb; mrs %0, cntpct_el0" : "=r"(val));
+    return val;
+}
+
+static inline uint64_t read_cntfrq(void) {
+    uint64_t val;
+    __asm__ volatile ("mrs %0, cntfrq_el0" : "=r"(val));
+    return val;
+}
+
 /* Initialize system timer */
 void timer_init(void) {
     /* Read timer frequency */
-    timer_freq = *CNTFRQ_EL0;
+    uint32_t freq = (uint32_t)read_cntfrq();
+    if (freq) {
+        timer_freq = freq;
+    }
 }
 
 /* Get current timer tick */
 uint64_t timer_get_ticks(void) {
-    return *CNTPCT_EL0;
+    return read_cntpct();
+}
+
+/* Split so ticks * 1000000 cannot overflow */
+uint32_t timer_us(void) {
+    uint64_t ticks = read_cntpct();
+    uint64_t us = (ticks / timer_freq) * 1000000 + (ticks % timer_freq) * 1000000 / timer_freq;
+    return (uint32_t)us;
+}
+
+/*
+ * Start the counter's event stream: an event every 2^(n+1) ticks, with n
+ * picked for about a millisecond, so a WFE never sleeps longer than that.
+ * Needs neither the GIC nor a vector table. At EL2 the stream is
+ * controlled by CNTHCTL_EL2, at EL1 by CNTKCTL_EL1; both keep EVNTI in
+ * bits 7:4 and EVNTEN in bit 2.
+ */
+void timer_events_init(void) {
+    uint32_t n = 0;
+    while (n < 15 && (2u << n) < timer_freq / 1000) {
+        n++;
+    }
+    
+    uint64_t el, ctl;
+    __asm__ volatile ("mrs %0, CurrentEL" : "=r"(el));
+    if (((el >> 2) & 3) == 2) {
+        __asm__ volatile ("mrs %0, cnthctl_el2" : "=r"(ctl));
+        ctl = (ctl & ~0xFCUL) | (n << 4) | (1 << 2);
+        __asm__ volatile ("msr cnthctl_el2, %0; isb" : : "r"(ctl));
+    } else {
+        __asm__ volatile ("mrs %0, cntkctl_el1" : "=r"(ctl));
+        ctl = (ctl & ~0xFCUL) | (n << 4) | (1 << 2);
+        __asm__ volatile ("msr cntkctl_el1, %0; isb" : : "r"(ctl));
+    }
+}
+
+/* Sleep until the next event: a stream tick, an SEV or an interrupt */
+void timer_idle(void) {
+    __asm__ volatile ("wfe" : : : "memory");
 }
 
 /* Delay for specified microseconds */
@@ -13,6 +13,15 @@ void timer_init(void);
 /* Get current timer tick */
 uint64_t timer_get_ticks(void);
 
+/* Microseconds since boot, wrapping at 32 bits (for frame pacing) */
+uint32_t timer_us(void);
+
+/* Wake WFE about once a millisecond from the counter's event stream */
+void timer_events_init(void);
+
+/* Sleep until the next timer event or interrupt */
+void timer_idle(void);
+
 /* Delay for specified microseconds */
 void delay_us(uint32_t us);
 
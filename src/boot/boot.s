@@ -26,8 +26,18 @@ _start:
   # Set up stack - stack grows downward, so top is the highest address
   mov $stack_top, %esp
   
-  # Push multiboot info pointer (in EBX) as argument
-  # stdcall/cdecl: arguments pushed right-to-left
+  # Enable SSE for the gfx span kernels (ECX only: EAX/EBX hold Multiboot state)
+  mov %cr0, %ecx
+  and $~0x4, %ecx        # Clear CR0.EM (no x87 emulation)
+  or $0x2, %ecx          # Set CR0.MP
+  mov %ecx, %cr0
+  mov %cr4, %ecx
+  or $0x600, %ecx        # Set CR4.OSFXSR and CR4.OSXMMEXCPT
+  mov %ecx, %cr4
+  
+  # Pass kernel_main(info, magic): the multiboot magic is in EAX and the
+  # info pointer in EBX. cdecl pushes arguments right-to-left
+  push %eax
   push %ebx
   
   # Call C kernel_main
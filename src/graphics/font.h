@@ -0,0 +1,39 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+
+// Bitmap fonts as packed tables, generated from BDF/PSF sources by
+// tools/fontgen.py (see font_atlas.c). Glyph bitmaps are cropped to their
+// inked pixels and stored row after row; bit n of byte k in a row is
+// column left + 8k + n.
+typedef struct {
+    uint8_t advance;            // pen movement to the next glyph
+    int8_t left;                // first bitmap column, relative to the pen
+    int8_t top;                 // first bitmap row, relative to the cell top
+    uint8_t width, height;      // bitmap size in pixels
+    uint16_t bitmap;            // offset of the first row in the bitmap table
+} gfx_glyph_t;
+
+typedef struct {
+    const char* name;
+    uint8_t cell_width, cell_height;
+    uint8_t ascent;
+    uint8_t row_bytes;          // bytes per bitmap row
+    uint16_t first, last;       // codepoints covered by index
+    uint16_t glyph_count;
+    const uint16_t* index;      // codepoint - first -> glyph (0: missing)
+    const gfx_glyph_t* glyphs;  // glyph 0 is empty and one cell wide
+    const uint8_t* bitmap;
+} gfx_font_t;
+
+// The built-in 5x7 font in 8x7 cells (fonts/flux-5x7.bdf)
+extern const gfx_font_t font_5x7;
+
+// Glyph for a codepoint; the empty glyph 0 if the font lacks it
+static inline const gfx_glyph_t* font_glyph(const gfx_font_t* font, uint32_t codepoint) {
+    if (codepoint < font->first || codepoint > font->last) return &font->glyphs[0];
+    return &font->glyphs[font->index[codepoint - font->first]];
+}
+
+#endif // FONT_H
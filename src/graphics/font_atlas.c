@@ -0,0 +1,160 @@
+// Generated by tools/fontgen.py from fonts/flux-5x7.bdf; do not edit
+#include "font.h"
+
+// flux-5x7.bdf: 8x7 cells, U+0020..U+007E
+static const uint8_t font_5x7_bitmap[] = {
+    0x1F,  // U+002D -
+    0x03, 0x03,  // U+002E .
+    0x10, 0x08, 0x04, 0x02, 0x01,  // U+002F /
+    0x0E, 0x11, 0x19, 0x15, 0x17, 0x11, 0x0E,  // U+0030 0
+    0x02, 0x03, 0x02, 0x02, 0x02, 0x02, 0x07,  // U+0031 1
+    0x0E, 0x11, 0x10, 0x0C, 0x02, 0x01, 0x1F,  // U+0032 2
+    0x0E, 0x11, 0x10, 0x0E, 0x10, 0x11, 0x0E,  // U+0033 3
+    0x08, 0x0C, 0x0A, 0x09, 0x1F, 0x08, 0x08,  // U+0034 4
+    0x1F, 0x01, 0x01, 0x0F, 0x10, 0x11, 0x0E,  // U+0035 5
+    0x0C, 0x02, 0x01, 0x0F, 0x11, 0x11, 0x0E,  // U+0036 6
+    0x1F, 0x10, 0x08, 0x04, 0x04, 0x04, 0x04,  // U+0037 7
+    0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E,  // U+0038 8
+    0x0E, 0x11, 0x11, 0x1E, 0x10, 0x00, 0x0E,  // U+0039 9
+    0x03, 0x03, 0x00, 0x03, 0x03,  // U+003A :
+    0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11,  // U+0041 A
+    0x0F, 0x11, 0x11, 0x0F, 0x11, 0x11, 0x0F,  // U+0042 B
+    0x0E, 0x11, 0x01, 0x01, 0x01, 0x11, 0x0E,  // U+0043 C
+    0x0F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0F,  // U+0044 D
+    0x1F, 0x01, 0x01, 0x0F, 0x01, 0x01, 0x1F,  // U+0045 E
+    0x1F, 0x01, 0x01, 0x0F, 0x01, 0x01, 0x01,  // U+0046 F
+    0x0E, 0x11, 0x01, 0x0D, 0x11, 0x11, 0x0E,  // U+0047 G
+    0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11,  // U+0048 H
+    0x07, 0x02, 0x02, 0x02, 0x02, 0x02, 0x07,  // U+0049 I
+    0x1C, 0x08, 0x08, 0x08, 0x08, 0x09, 0x06,  // U+004A J
+    0x11, 0x09, 0x05, 0x03, 0x05, 0x09, 0x11,  // U+004B K
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x1F,  // U+004C L
+    0x11, 0x1B, 0x15, 0x11, 0x11, 0x11, 0x11,  // U+004D M
+    0x11, 0x11, 0x13, 0x15, 0x19, 0x11, 0x11,  // U+004E N
+    0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E,  // U+004F O
+    0x0F, 0x11, 0x11, 0x0F, 0x01, 0x01, 0x01,  // U+0050 P
+    0x0E, 0x11, 0x11, 0x15, 0x11, 0x09, 0x16,  // U+0051 Q
+    0x0F, 0x11, 0x11, 0x0F, 0x05, 0x09, 0x11,  // U+0052 R
+    0x0E, 0x11, 0x01, 0x0E, 0x10, 0x11, 0x0E,  // U+0053 S
+    0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,  // U+0054 T
+    0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E,  // U+0055 U
+    0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04,  // U+0056 V
+    0x11, 0x11, 0x11, 0x11, 0x15, 0x1B, 0x11,  // U+0057 W
+    0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11,  // U+0058 X
+    0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04,  // U+0059 Y
+    0x1F, 0x10, 0x08, 0x04, 0x02, 0x01, 0x1F,  // U+005A Z
+    0x0E, 0x10, 0x1E, 0x11, 0x1E,  // U+0061 a
+    0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F,  // U+0062 b
+    0x0E, 0x01, 0x01, 0x11, 0x0E,  // U+0063 c
+    0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E,  // U+0064 d
+    0x0E, 0x11, 0x1F, 0x01, 0x0E,  // U+0065 e
+    0x0C, 0x12, 0x02, 0x07, 0x02, 0x02, 0x02,  // U+0066 f
+    0x1E, 0x11, 0x11, 0x1E, 0x10, 0x0E,  // U+0067 g
+    0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x11,  // U+0068 h
+    0x02, 0x00, 0x03, 0x02, 0x02, 0x02, 0x07,  // U+0069 i
+    0x08, 0x00, 0x0C, 0x08, 0x08, 0x09, 0x06,  // U+006A j
+    0x01, 0x01, 0x09, 0x05, 0x03, 0x05, 0x09,  // U+006B k
+    0x03, 0x02, 0x02, 0x02, 0x02, 0x02, 0x07,  // U+006C l
+    0x0B, 0x15, 0x15, 0x15, 0x15,  // U+006D m
+    0x0D, 0x13, 0x11, 0x11, 0x11,  // U+006E n
+    0x0E, 0x11, 0x11, 0x11, 0x0E,  // U+006F o
+    0x0F, 0x11, 0x0F, 0x01, 0x01,  // U+0070 p
+    0x16, 0x19, 0x1E, 0x10, 0x10,  // U+0071 q
+    0x0D, 0x13, 0x01, 0x01, 0x01,  // U+0072 r
+    0x0E, 0x01, 0x0E, 0x10, 0x0F,  // U+0073 s
+    0x02, 0x02, 0x07, 0x02, 0x02, 0x12, 0x0C,  // U+0074 t
+    0x11, 0x11, 0x11, 0x19, 0x16,  // U+0075 u
+    0x11, 0x11, 0x11, 0x0A, 0x04,  // U+0076 v
+    0x11, 0x15, 0x15, 0x15, 0x0A,  // U+0077 w
+    0x11, 0x0A, 0x04, 0x0A, 0x11,  // U+0078 x
+    0x11, 0x11, 0x1E, 0x10, 0x0E,  // U+0079 y
+    0x1F, 0x08, 0x04, 0x02, 0x1F,  // U+007A z
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,  // U+007C |
+};
+
+static const gfx_glyph_t font_5x7_glyphs[] = {
+    {8, 0, 0, 0, 0, 0},  // missing
+    {8, 0, 0, 0, 0, 0},  // U+0020
+    {8, 0, 3, 5, 1, 0},  // U+002D -
+    {8, 1, 5, 2, 2, 1},  // U+002E .
+    {8, 0, 1, 5, 5, 3},  // U+002F /
+    {8, 0, 0, 5, 7, 8},  // U+0030 0
+    {8, 1, 0, 3, 7, 15},  // U+0031 1
+    {8, 0, 0, 5, 7, 22},  // U+0032 2
+    {8, 0, 0, 5, 7, 29},  // U+0033 3
+    {8, 0, 0, 5, 7, 36},  // U+0034 4
+    {8, 0, 0, 5, 7, 43},  // U+0035 5
+    {8, 0, 0, 5, 7, 50},  // U+0036 6
+    {8, 0, 0, 5, 7, 57},  // U+0037 7
+    {8, 0, 0, 5, 7, 64},  // U+0038 8
+    {8, 0, 0, 5, 7, 71},  // U+0039 9
+    {8, 1, 1, 2, 5, 78},  // U+003A :
+    {8, 0, 0, 5, 7, 83},  // U+0041 A
+    {8, 0, 0, 5, 7, 90},  // U+0042 B
+    {8, 0, 0, 5, 7, 97},  // U+0043 C
+    {8, 0, 0, 5, 7, 104},  // U+0044 D
+    {8, 0, 0, 5, 7, 111},  // U+0045 E
+    {8, 0, 0, 5, 7, 118},  // U+0046 F
+    {8, 0, 0, 5, 7, 125},  // U+0047 G
+    {8, 0, 0, 5, 7, 132},  // U+0048 H
+    {8, 0, 0, 3, 7, 139},  // U+0049 I
+    {8, 0, 0, 5, 7, 146},  // U+004A J
+    {8, 0, 0, 5, 7, 153},  // U+004B K
+    {8, 0, 0, 5, 7, 160},  // U+004C L
+    {8, 0, 0, 5, 7, 167},  // U+004D M
+    {8, 0, 0, 5, 7, 174},  // U+004E N
+    {8, 0, 0, 5, 7, 181},  // U+004F O
+    {8, 0, 0, 5, 7, 188},  // U+0050 P
+    {8, 0, 0, 5, 7, 195},  // U+0051 Q
+    {8, 0, 0, 5, 7, 202},  // U+0052 R
+    {8, 0, 0, 5, 7, 209},  // U+0053 S
+    {8, 0, 0, 5, 7, 216},  // U+0054 T
+    {8, 0, 0, 5, 7, 223},  // U+0055 U
+    {8, 0, 0, 5, 7, 230},  // U+0056 V
+    {8, 0, 0, 5, 7, 237},  // U+0057 W
+    {8, 0, 0, 5, 7, 244},  // U+0058 X
+    {8, 0, 0, 5, 7, 251},  // U+0059 Y
+    {8, 0, 0, 5, 7, 258},  // U+005A Z
+    {8, 0, 2, 5, 5, 265},  // U+0061 a
+    {8, 0, 0, 5, 7, 270},  // U+0062 b
+    {8, 0, 2, 5, 5, 277},  // U+0063 c
+    {8, 0, 0, 5, 7, 282},  // U+0064 d
+    {8, 0, 2, 5, 5, 289},  // U+0065 e
+    {8, 0, 0, 5, 7, 294},  // U+0066 f
+    {8, 0, 1, 5, 6, 301},  // U+0067 g
+    {8, 0, 0, 5, 7, 307},  // U+0068 h
+    {8, 0, 0, 3, 7, 314},  // U+0069 i
+    {8, 0, 0, 4, 7, 321},  // U+006A j
+    {8, 0, 0, 4, 7, 328},  // U+006B k
+    {8, 0, 0, 3, 7, 335},  // U+006C l
+    {8, 0, 2, 5, 5, 342},  // U+006D m
+    {8, 0, 2, 5, 5, 347},  // U+006E n
+    {8, 0, 2, 5, 5, 352},  // U+006F o
+    {8, 0, 2, 5, 5, 357},  // U+0070 p
+    {8, 0, 2, 5, 5, 362},  // U+0071 q
+    {8, 0, 2, 5, 5, 367},  // U+0072 r
+    {8, 0, 2, 5, 5, 372},  // U+0073 s
+    {8, 0, 0, 5, 7, 377},  // U+0074 t
+    {8, 0, 2, 5, 5, 384},  // U+0075 u
+    {8, 0, 2, 5, 5, 389},  // U+0076 v
+    {8, 0, 2, 5, 5, 394},  // U+0077 w
+    {8, 0, 2, 5, 5, 399},  // U+0078 x
+    {8, 0, 2, 5, 5, 404},  // U+0079 y
+    {8, 0, 2, 5, 5, 409},  // U+007A z
+    {8, 2, 0, 1, 7, 414},  // U+007C |
+};
+
+static const uint16_t font_5x7_index[] = {
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 4,
+    5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 0, 0, 0, 0,
+    0, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30,
+    31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 0, 0, 0, 0, 0,
+    0, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56,
+    57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 0, 68, 0, 0,
+};
+
+const gfx_font_t font_5x7 = {
+    "flux-5x7", 8, 7, 7, 1,
+    0x0020, 0x007E, 69,
+    font_5x7_index, font_5x7_glyphs, font_5x7_bitmap
+};
@@ -1,4 +1,6 @@
 #include "gfx.h"
+#include "span.h"
+#include "font.h"
 #include "../gui/gui.h"
 
 // Define global framebuffer state here
@@ -7,190 +9,1268 @@ int screen_width = 0;
 int screen_height = 0;
 int pitch = 4096;  // Default pitch for 1024x768x32 (1024 pixels * 4 bytes)
 
-// Current mouse cursor position
+// Off-screen back buffer. It lives in normal (cacheable) RAM, so drawing and
+// read-back are cheap; gfx_present() pushes only the damaged parts of it out
+// to the scanout framebuffer.
+static uint32_t back_buffer[GFX_BACKBUFFER_MAX_WIDTH * GFX_BACKBUFFER_MAX_HEIGHT] __attribute__((aligned(64)));
+static int back_buffer_active = 0;
+
+// Framebuffer format. scanout_span packs back buffer pixels into it and is
+// bound once by gfx_init(), so presenting never tests the format per pixel.
+typedef void (*scanout_fn)(void* dst, const uint32_t* src, int count);
+static gfx_format_t requested_format = GFX_FORMAT_XRGB8888;
+static scanout_fn scanout_span = 0;
+static int scanout_bytes = 4;
+
+// Render target: the back buffer when it is active, otherwise the framebuffer
+static uint32_t* draw_buffer = 0;
+static int draw_pitch = 0;
+
+// Render target saved while drawing is redirected into a surface
+static int surface_target = 0;
+static int surface_right = 0;
+static int surface_bottom = 0;
+static uint32_t* saved_draw_buffer = 0;
+static int saved_draw_pitch = 0;
+static gfx_rect_t saved_clip;
+static int saved_clip_depth = 0;
+static int saved_clip_overflow = 0;
+
+// Clip stack. clip_rect is the active clip (always within the screen);
+// the stack holds the enclosing clips to restore on pop.
+#define GFX_CLIP_DEPTH 16
+static gfx_rect_t clip_rect = {0, 0, 0, 0};
+static gfx_rect_t clip_stack[GFX_CLIP_DEPTH];
+static int clip_depth = 0;
+static int clip_overflow = 0;
+
+// Damage rectangles accumulated since the last present
+#define GFX_MAX_DAMAGE 32
+static gfx_rect_t damage_rects[GFX_MAX_DAMAGE];
+static int damage_count = 0;
+
+// Page flipping: fb_pages[front_page] is on screen. The hidden page last
+// received the frame before the current one, so it also needs whatever the
+// previous present changed (prev_damage).
+static uint32_t* fb_pages[2];
+static int front_page = 0;
+static gfx_flip_fn page_flip = 0;
+static gfx_rect_t prev_damage[GFX_MAX_DAMAGE];
+static int prev_damage_count = 0;
+
+// Tile hashing: a hash per 64x64 tile of what each framebuffer page was
+// last sent, so a present skips damaged tiles whose pixels did not change.
+// tile_seen stamps a tile with the present that visited it.
+#define GFX_TILE_SHIFT 6
+#define GFX_TILE_SIZE (1 << GFX_TILE_SHIFT)
+#define GFX_TILE_COLS ((GFX_BACKBUFFER_MAX_WIDTH + GFX_TILE_SIZE - 1) / GFX_TILE_SIZE)
+#define GFX_TILE_ROWS ((GFX_BACKBUFFER_MAX_HEIGHT + GFX_TILE_SIZE - 1) / GFX_TILE_SIZE)
+#define GFX_TILE_COUNT (GFX_TILE_COLS * GFX_TILE_ROWS)
+#define GFX_TILE_SMALL (GFX_TILE_SIZE * GFX_TILE_SIZE / 8)
+static int tile_hashing = 0;
+static uint32_t tile_hash[2][GFX_TILE_COUNT];
+static uint8_t tile_known[2][GFX_TILE_COUNT];
+static uint32_t tile_seen[GFX_TILE_COUNT];
+static uint32_t tile_frame = 0;
+static uint32_t tiles_hashed = 0;
+static uint32_t tiles_copied = 0;
+
+// Pixels written by fills (rectangles, shapes) and by blits since boot
+static uint32_t pixels_filled = 0;
+static uint32_t pixels_blitted = 0;
+
+// Mouse cursor: a top layer that is only in the back buffer while a
+// present copies it out, so drawing never has to work around it and
+// moving it damages two 16x16 cells. cursor_bg holds what it covers.
 static int cursor_x = 0;
 static int cursor_y = 0;
 static int cursor_visible = 0;
 static uint32_t cursor_bg[16][16];  // Save background for cursor
+static void cursor_swap(int restore);
+
+// Row pointer into the render target
+static inline uint32_t* target_row(int y) {
+    return (uint32_t*)((uint8_t*)draw_buffer + y * draw_pitch);
+}
+
+static void scanout_copy(void* dst, const uint32_t* src, int count) {
+    span_move32((uint32_t*)dst, src, count);
+}
+
+void gfx_set_format(gfx_format_t format) {
+    requested_format = format;
+}
+
+uint32_t gfx_palette_color(int index) {
+    uint32_t r = ((index >> 5) & 7) * 255 / 7;
+    uint32_t g = ((index >> 2) & 7) * 255 / 7;
+    uint32_t b = (index & 3) * 255 / 3;
+    return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+// Forget what the framebuffer pages hold, so every tile is sent again
+static void tiles_forget(void) {
+    for (int i = 0; i < GFX_TILE_COUNT; i++) {
+        tile_known[0][i] = 0;
+        tile_known[1][i] = 0;
+    }
+}
 
 // Initialize graphics with framebuffer parameters (for ARM)
 void gfx_init(int width, int height, void* fb, int fb_pitch) {
+    // Bind the scanout packer for the framebuffer format
+    switch (requested_format) {
+        case GFX_FORMAT_XBGR8888:
+            scanout_span = span_to_xbgr8888;
+            scanout_bytes = 4;
+            break;
+        case GFX_FORMAT_RGB565:
+            scanout_span = span_to_rgb565;
+            scanout_bytes = 2;
+            break;
+        case GFX_FORMAT_PAL8:
+            scanout_span = span_to_pal8;
+            scanout_bytes = 1;
+            break;
+        default:
+            scanout_span = scanout_copy;
+            scanout_bytes = 4;
+            break;
+    }
+    
+    // Other formats can only be reached through the back buffer, so limit
+    // the drawn area to what it holds
+    if (requested_format != GFX_FORMAT_XRGB8888) {
+        if (width > GFX_BACKBUFFER_MAX_WIDTH) width = GFX_BACKBUFFER_MAX_WIDTH;
+        if (height > GFX_BACKBUFFER_MAX_HEIGHT) height = GFX_BACKBUFFER_MAX_HEIGHT;
+    }
+    
     screen_width = width;
     screen_height = height;
     framebuffer = (uint32_t*)fb;
     pitch = fb_pitch;
     cursor_x = width / 2;
     cursor_y = height / 2;
+    
+    // Render off-screen when the mode fits the back buffer, otherwise
+    // fall back to drawing straight into the framebuffer
+    if (fb && width <= GFX_BACKBUFFER_MAX_WIDTH && height <= GFX_BACKBUFFER_MAX_HEIGHT) {
+        back_buffer_active = 1;
+        draw_buffer = back_buffer;
+        draw_pitch = width * 4;
+    } else {
+        back_buffer_active = 0;
+        draw_buffer = framebuffer;
+        draw_pitch = fb_pitch;
+    }
+    
+    gfx_reset_clip();
+    
+    page_flip = 0;
+    damage_count = 0;
+    tiles_forget();
+    gfx_damage(0, 0, width, height);
 }
 
-// Simple 5x7 bitmap font for numbers and letters
-static const uint8_t font_data[256][7] = {
-    [' '] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-    ['0'] = {0x3E, 0x51, 0x59, 0x45, 0x3E, 0x00, 0x00},
-    ['1'] = {0x00, 0x42, 0x7F, 0x40, 0x00, 0x00, 0x00},
-    ['2'] = {0x62, 0x51, 0x49, 0x49, 0x46, 0x00, 0x00},
-    ['3'] = {0x22, 0x49, 0x49, 0x49, 0x36, 0x00, 0x00},
-    ['4'] = {0x18, 0x14, 0x12, 0x7F, 0x10, 0x00, 0x00},
-    ['5'] = {0x2F, 0x49, 0x49, 0x49, 0x31, 0x00, 0x00},
-    ['6'] = {0x3C, 0x4A, 0x49, 0x49, 0x30, 0x00, 0x00},
-    ['7'] = {0x01, 0x01, 0x79, 0x05, 0x03, 0x00, 0x00},
-    ['8'] = {0x36, 0x49, 0x49, 0x49, 0x36, 0x00, 0x00},
-    ['9'] = {0x06, 0x49, 0x49, 0x49, 0x1E, 0x00, 0x00},
-    ['A'] = {0x7E, 0x09, 0x09, 0x09, 0x7E, 0x00, 0x00},
-    ['B'] = {0x7F, 0x49, 0x49, 0x49, 0x36, 0x00, 0x00},
-    ['C'] = {0x3E, 0x41, 0x41, 0x41, 0x22, 0x00, 0x00},
-    ['D'] = {0x7F, 0x41, 0x41, 0x41, 0x3E, 0x00, 0x00},
-    ['E'] = {0x7F, 0x49, 0x49, 0x49, 0x41, 0x00, 0x00},
-    ['F'] = {0x7F, 0x09, 0x09, 0x09, 0x01, 0x00, 0x00},
-    ['G'] = {0x3E, 0x41, 0x49, 0x49, 0x32, 0x00, 0x00},
-    ['H'] = {0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00, 0x00},
-    ['I'] = {0x41, 0x7F, 0x41, 0x00, 0x00, 0x00, 0x00},
-    ['J'] = {0x20, 0x40, 0x41, 0x3F, 0x01, 0x00, 0x00},
-    ['K'] = {0x7F, 0x08, 0x14, 0x22, 0x41, 0x00, 0x00},
-    ['L'] = {0x7F, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00},
-    ['M'] = {0x7F, 0x02, 0x04, 0x02, 0x7F, 0x00, 0x00},
-    ['N'] = {0x7F, 0x04, 0x08, 0x10, 0x7F, 0x00, 0x00},
-    ['O'] = {0x3E, 0x41, 0x41, 0x41, 0x3E, 0x00, 0x00},
-    ['P'] = {0x7F, 0x09, 0x09, 0x09, 0x06, 0x00, 0x00},
-    ['Q'] = {0x3E, 0x41, 0x49, 0x21, 0x5E, 0x00, 0x00},
-    ['R'] = {0x7F, 0x09, 0x19, 0x29, 0x46, 0x00, 0x00},
-    ['S'] = {0x26, 0x49, 0x49, 0x49, 0x32, 0x00, 0x00},
-    ['T'] = {0x01, 0x01, 0x7F, 0x01, 0x01, 0x00, 0x00},
-    ['U'] = {0x3F, 0x40, 0x40, 0x40, 0x3F, 0x00, 0x00},
-    ['V'] = {0x1F, 0x20, 0x40, 0x20, 0x1F, 0x00, 0x00},
-    ['W'] = {0x7F, 0x20, 0x10, 0x20, 0x7F, 0x00, 0x00},
-    ['X'] = {0x63, 0x14, 0x08, 0x14, 0x63, 0x00, 0x00},
-    ['Y'] = {0x07, 0x08, 0x70, 0x08, 0x07, 0x00, 0x00},
-    ['Z'] = {0x61, 0x51, 0x49, 0x45, 0x43, 0x00, 0x00},
-    ['a'] = {0x20, 0x54, 0x54, 0x54, 0x78, 0x00, 0x00},
-    ['b'] = {0x7F, 0x48, 0x44, 0x44, 0x38, 0x00, 0x00},
-    ['c'] = {0x38, 0x44, 0x44, 0x44, 0x20, 0x00, 0x00},
-    ['d'] = {0x38, 0x44, 0x44, 0x48, 0x7F, 0x00, 0x00},
-    ['e'] = {0x38, 0x54, 0x54, 0x54, 0x18, 0x00, 0x00},
-    ['f'] = {0x08, 0x7E, 0x09, 0x01, 0x02, 0x00, 0x00},
-    ['g'] = {0x0C, 0x52, 0x52, 0x52, 0x3E, 0x00, 0x00},
-    ['h'] = {0x7F, 0x08, 0x04, 0x04, 0x78, 0x00, 0x00},
-    ['i'] = {0x44, 0x7D, 0x40, 0x00, 0x00, 0x00, 0x00},
-    ['j'] = {0x20, 0x40, 0x44, 0x3D, 0x00, 0x00, 0x00},
-    ['k'] = {0x7F, 0x10, 0x28, 0x44, 0x00, 0x00, 0x00},
-    ['l'] = {0x41, 0x7F, 0x40, 0x00, 0x00, 0x00, 0x00},
-    ['m'] = {0x7C, 0x04, 0x78, 0x04, 0x78, 0x00, 0x00},
-    ['n'] = {0x7C, 0x08, 0x04, 0x04, 0x78, 0x00, 0x00},
-    ['o'] = {0x38, 0x44, 0x44, 0x44, 0x38, 0x00, 0x00},
-    ['p'] = {0x7C, 0x14, 0x14, 0x14, 0x08, 0x00, 0x00},
-    ['q'] = {0x08, 0x14, 0x14, 0x18, 0x7C, 0x00, 0x00},
-    ['r'] = {0x7C, 0x08, 0x04, 0x04, 0x08, 0x00, 0x00},
-    ['s'] = {0x48, 0x54, 0x54, 0x54, 0x20, 0x00, 0x00},
-    ['t'] = {0x04, 0x3F, 0x44, 0x40, 0x20, 0x00, 0x00},
-    ['u'] = {0x3C, 0x40, 0x40, 0x20, 0x7C, 0x00, 0x00},
-    ['v'] = {0x1C, 0x20, 0x40, 0x20, 0x1C, 0x00, 0x00},
-    ['w'] = {0x3C, 0x40, 0x38, 0x40, 0x3C, 0x00, 0x00},
-    ['x'] = {0x44, 0x28, 0x10, 0x28, 0x44, 0x00, 0x00},
-    ['y'] = {0x0C, 0x50, 0x50, 0x50, 0x3C, 0x00, 0x00},
-    ['z'] = {0x44, 0x64, 0x54, 0x4C, 0x44, 0x00, 0x00},
-    [':'] = {0x00, 0x36, 0x36, 0x00, 0x00, 0x00, 0x00},
-    ['.'] = {0x00, 0x60, 0x60, 0x00, 0x00, 0x00, 0x00},
-    ['-'] = {0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00},
-    ['/'] = {0x20, 0x10, 0x08, 0x04, 0x02, 0x00, 0x00},
-    ['|'] = {0x00, 0x00, 0x7F, 0x00, 0x00, 0x00, 0x00},
-};
+void gfx_get_size(int* width, int* height) {
+    *width = screen_width;
+    *height = screen_height;
+}
 
-void set_pixel(int x, int y, uint32_t color) {
-    if (x >= 0 && x < screen_width && y >= 0 && y < screen_height && framebuffer) {
-        uint32_t* row = (uint32_t*)((uint8_t*)framebuffer + y * pitch);
-        row[x] = color;
+// Present by flipping between two framebuffer pages. Needs the back buffer,
+// which both pages are refreshed from.
+void gfx_enable_page_flip(void* second_page, gfx_flip_fn flip) {
+    if (!back_buffer_active || !second_page || !flip) return;
+    
+    fb_pages[0] = framebuffer;
+    fb_pages[1] = (uint32_t*)second_page;
+    front_page = 0;
+    page_flip = flip;
+    
+    // Neither page holds anything yet
+    prev_damage[0].x = 0;
+    prev_damage[0].y = 0;
+    prev_damage[0].width = screen_width;
+    prev_damage[0].height = screen_height;
+    prev_damage_count = 1;
+    tiles_forget();
+    gfx_damage(0, 0, screen_width, screen_height);
+}
+
+// Intersect a rectangle with the active clip; returns 0 if nothing is left
+static int clip_to_active(int* x, int* y, int* width, int* height) {
+    int x1 = *x, y1 = *y;
+    int x2 = *x + *width, y2 = *y + *height;
+    
+    if (x1 < clip_rect.x) x1 = clip_rect.x;
+    if (y1 < clip_rect.y) y1 = clip_rect.y;
+    if (x2 > clip_rect.x + clip_rect.width) x2 = clip_rect.x + clip_rect.width;
+    if (y2 > clip_rect.y + clip_rect.height) y2 = clip_rect.y + clip_rect.height;
+    if (x2 <= x1 || y2 <= y1) return 0;
+    
+    *x = x1;
+    *y = y1;
+    *width = x2 - x1;
+    *height = y2 - y1;
+    return 1;
+}
+
+// Narrow the clip to its intersection with a rectangle
+void gfx_push_clip(int x, int y, int width, int height) {
+    if (clip_depth < GFX_CLIP_DEPTH) {
+        clip_stack[clip_depth++] = clip_rect;
+    } else {
+        // Too deep to remember: keep narrowing, the matching pop is a no-op
+        clip_overflow++;
     }
+    
+    if (!clip_to_active(&x, &y, &width, &height)) {
+        x = y = width = height = 0;
+    }
+    clip_rect.x = x;
+    clip_rect.y = y;
+    clip_rect.width = width;
+    clip_rect.height = height;
 }
 
-void fill_rect(int x, int y, int width, int height, uint32_t color) {
+// Restore the clip active before the matching gfx_push_clip()
+void gfx_pop_clip(void) {
+    if (clip_overflow > 0) {
+        clip_overflow--;
+    } else if (clip_depth > 0) {
+        clip_rect = clip_stack[--clip_depth];
+    }
+}
+
+// Drop all pushed clips and clip to the whole screen
+void gfx_reset_clip(void) {
+    clip_depth = 0;
+    clip_overflow = 0;
+    clip_rect.x = 0;
+    clip_rect.y = 0;
+    clip_rect.width = screen_width;
+    clip_rect.height = screen_height;
+}
+
+void gfx_get_clip(gfx_rect_t* rect) {
+    *rect = clip_rect;
+}
+
+static inline int rect_area(const gfx_rect_t* r) {
+    return r->width * r->height;
+}
+
+static gfx_rect_t rect_union(const gfx_rect_t* a, const gfx_rect_t* b) {
+    gfx_rect_t r;
+    int x2 = (a->x + a->width > b->x + b->width) ? a->x + a->width : b->x + b->width;
+    int y2 = (a->y + a->height > b->y + b->height) ? a->y + a->height : b->y + b->height;
+    r.x = (a->x < b->x) ? a->x : b->x;
+    r.y = (a->y < b->y) ? a->y : b->y;
+    r.width = x2 - r.x;
+    r.height = y2 - r.y;
+    return r;
+}
+
+// Record a screen area that must be copied out on the next present
+void gfx_damage(int x, int y, int width, int height) {
+    if (!back_buffer_active || surface_target) return;
+    
     // Clamp to screen bounds
-    if (x < 0) x = 0;
-    if (y < 0) y = 0;
+    if (x < 0) { width += x; x = 0; }
+    if (y < 0) { height += y; y = 0; }
     if (x + width > screen_width) width = screen_width - x;
     if (y + height > screen_height) height = screen_height - y;
+    if (width <= 0 || height <= 0) return;
     
-    // Fast fill using direct memory writes with pitch
-    if (framebuffer) {
-        for (int py = y; py < y + height; py++) {
-            uint32_t* row = (uint32_t*)((uint8_t*)framebuffer + py * pitch);
-            for (int px = x; px < x + width; px++) {
-                row[px] = color;
+    gfx_rect_t r = {x, y, width, height};
+    
+    // Absorb existing rectangles when the bounding box wastes no area
+    // (containment, overlap along an edge, or abutting strips such as the
+    // characters of a string). Growing may enable further merges, so rescan.
+    int i = 0;
+    while (i < damage_count) {
+        gfx_rect_t u = rect_union(&damage_rects[i], &r);
+        if (rect_area(&u) <= rect_area(&damage_rects[i]) + rect_area(&r)) {
+            r = u;
+            damage_rects[i] = damage_rects[--damage_count];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    
+    // List full: fold into whichever rectangle grows the least
+    if (damage_count == GFX_MAX_DAMAGE) {
+        int best = 0;
+        int best_cost = 0x7FFFFFFF;
+        for (i = 0; i < damage_count; i++) {
+            gfx_rect_t u = rect_union(&damage_rects[i], &r);
+            int cost = rect_area(&u) - rect_area(&damage_rects[i]);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = i;
             }
         }
+        damage_rects[best] = rect_union(&damage_rects[best], &r);
+        return;
+    }
+    
+    damage_rects[damage_count++] = r;
+}
+
+int gfx_damage_pending(void) {
+    return back_buffer_active && damage_count > 0;
+}
+
+int gfx_damage_overlaps(int x, int y, int width, int height) {
+    for (int i = 0; i < damage_count; i++) {
+        gfx_rect_t* r = &damage_rects[i];
+        if (x < r->x + r->width && r->x < x + width &&
+            y < r->y + r->height && r->y < y + height) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void gfx_set_tile_hashing(int enabled) {
+    tile_hashing = enabled;
+    tiles_forget();
+}
+
+void gfx_tile_stats(uint32_t* hashed, uint32_t* copied) {
+    if (hashed) *hashed = tiles_hashed;
+    if (copied) *copied = tiles_copied;
+}
+
+void gfx_pixel_stats(uint32_t* filled, uint32_t* blitted) {
+    if (filled) *filled = pixels_filled;
+    if (blitted) *blitted = pixels_blitted;
+}
+
+// Send the damaged tiles of the back buffer whose hash differs from what
+// page last received. A tile is hashed and copied whole, once per present
+// however many damage rectangles touch it. Rectangles much smaller than a
+// tile (the cursor's cells) are cheaper to copy as they are; the tiles
+// they touch are then no longer known.
+static void present_tiles(uint8_t* target, int page) {
+    tile_frame++;
+    for (int i = 0; i < damage_count; i++) {
+        gfx_rect_t* r = &damage_rects[i];
+        if (r->width * r->height <= GFX_TILE_SMALL) continue;
+        int tx1 = r->x >> GFX_TILE_SHIFT, tx2 = (r->x + r->width - 1) >> GFX_TILE_SHIFT;
+        int ty1 = r->y >> GFX_TILE_SHIFT, ty2 = (r->y + r->height - 1) >> GFX_TILE_SHIFT;
+        
+        for (int ty = ty1; ty <= ty2; ty++) {
+            for (int tx = tx1; tx <= tx2; tx++) {
+                int t = ty * GFX_TILE_COLS + tx;
+                if (tile_seen[t] == tile_frame) continue;
+                tile_seen[t] = tile_frame;
+                
+                int x = tx << GFX_TILE_SHIFT, y = ty << GFX_TILE_SHIFT;
+                int w = (x + GFX_TILE_SIZE > screen_width) ? screen_width - x : GFX_TILE_SIZE;
+                int h = (y + GFX_TILE_SIZE > screen_height) ? screen_height - y : GFX_TILE_SIZE;
+                
+                uint32_t hash = 0;
+                for (int py = y; py < y + h; py++) {
+                    hash = span_hash32(target_row(py) + x, w, hash);
+                }
+                tiles_hashed++;
+                if (tile_known[page][t] && tile_hash[page][t] == hash) continue;
+                
+                tile_hash[page][t] = hash;
+                tile_known[page][t] = 1;
+                tiles_copied++;
+                for (int py = y; py < y + h; py++) {
+                    scanout_span(target + py * pitch + x * scanout_bytes, target_row(py) + x, w);
+                }
+            }
+        }
+    }
+    
+    for (int i = 0; i < damage_count; i++) {
+        gfx_rect_t* r = &damage_rects[i];
+        if (r->width * r->height > GFX_TILE_SMALL) continue;
+        
+        for (int py = r->y; py < r->y + r->height; py++) {
+            scanout_span(target + py * pitch + r->x * scanout_bytes, target_row(py) + r->x, r->width);
+        }
+        int tx1 = r->x >> GFX_TILE_SHIFT, tx2 = (r->x + r->width - 1) >> GFX_TILE_SHIFT;
+        int ty1 = r->y >> GFX_TILE_SHIFT, ty2 = (r->y + r->height - 1) >> GFX_TILE_SHIFT;
+        for (int ty = ty1; ty <= ty2; ty++) {
+            for (int tx = tx1; tx <= tx2; tx++) {
+                int t = ty * GFX_TILE_COLS + tx;
+                if (tile_seen[t] != tile_frame) tile_known[page][t] = 0;
+            }
+        }
+    }
+}
+
+// Copy damaged areas of the back buffer to the framebuffer. With page
+// flipping this is a swap: the hidden page is brought up to date and then
+// shown.
+void gfx_present(void) {
+    if (!back_buffer_active || !framebuffer) {
+        damage_count = 0;
+        return;
+    }
+    
+    uint32_t* target = framebuffer;
+    if (page_flip) {
+        // Nothing new: keep showing the current page
+        if (damage_count == 0) return;
+        
+        // Remember this frame's damage, then add what the hidden page missed
+        gfx_rect_t frame[GFX_MAX_DAMAGE];
+        int frame_count = damage_count;
+        for (int i = 0; i < frame_count; i++) {
+            frame[i] = damage_rects[i];
+        }
+        for (int i = 0; i < prev_damage_count; i++) {
+            gfx_damage(prev_damage[i].x, prev_damage[i].y, prev_damage[i].width, prev_damage[i].height);
+        }
+        for (int i = 0; i < frame_count; i++) {
+            prev_damage[i] = frame[i];
+        }
+        prev_damage_count = frame_count;
+        
+        target = fb_pages[front_page ^ 1];
+    }
+    
+    if (cursor_visible) cursor_swap(0);
+    if (tile_hashing) {
+        present_tiles((uint8_t*)target, page_flip ? front_page ^ 1 : 0);
+    } else {
+        for (int i = 0; i < damage_count; i++) {
+            gfx_rect_t* r = &damage_rects[i];
+            for (int py = r->y; py < r->y + r->height; py++) {
+                const uint32_t* src = target_row(py) + r->x;
+                uint8_t* dst = (uint8_t*)target + py * pitch + r->x * scanout_bytes;
+                scanout_span(dst, src, r->width);
+            }
+        }
+    }
+    if (cursor_visible) cursor_swap(1);
+    damage_count = 0;
+    
+    if (page_flip) {
+        front_page ^= 1;
+        framebuffer = fb_pages[front_page];
+        page_flip(front_page);
+    }
+}
+
+// Copy a block of the render target to another position. Source and
+// destination may overlap. The source is clipped to the screen and the
+// destination to the active clip.
+void gfx_copy_rect(int src_x, int src_y, int width, int height, int dst_x, int dst_y) {
+    gfx_surface_t target;
+    gfx_target_surface(&target);
+    gfx_rect_t r = {src_x, src_y, width, height};
+    gfx_blit(0, dst_x, dst_y, &target, &r);
+}
+
+// In drawing coordinates: while redirected, the surface's area ends at
+// (surface_right, surface_bottom)
+void gfx_target_surface(gfx_surface_t* surface) {
+    surface->pixels = draw_buffer;
+    surface->width = surface_target ? surface_right : screen_width;
+    surface->height = surface_target ? surface_bottom : screen_height;
+    surface->pitch = draw_pitch;
+}
+
+void gfx_begin_surface(gfx_surface_t* surface, int x, int y) {
+    if (surface_target || !surface || !surface->pixels) return;
+    
+    saved_draw_buffer = draw_buffer;
+    saved_draw_pitch = draw_pitch;
+    saved_clip = clip_rect;
+    saved_clip_depth = clip_depth;
+    saved_clip_overflow = clip_overflow;
+    surface_target = 1;
+    
+    // Offset the buffer so target_row(y)[x] lands on the surface pixel
+    draw_pitch = surface->pitch;
+    draw_buffer = (uint32_t*)((uint8_t*)surface->pixels - y * draw_pitch) - x;
+    surface_right = x + surface->width;
+    surface_bottom = y + surface->height;
+    clip_rect.x = x;
+    clip_rect.y = y;
+    clip_rect.width = surface->width;
+    clip_rect.height = surface->height;
+}
+
+void gfx_end_surface(void) {
+    if (!surface_target) return;
+    
+    draw_buffer = saved_draw_buffer;
+    draw_pitch = saved_draw_pitch;
+    clip_rect = saved_clip;
+    clip_depth = saved_clip_depth;
+    clip_overflow = saved_clip_overflow;
+    surface_target = 0;
+}
+
+// Blit row kernel; param is the colour key or alpha where the mode has one
+typedef void (*blit_row_fn)(uint32_t* dst, const uint32_t* src, int count, uint32_t param);
+
+static void blit_row_copy(uint32_t* dst, const uint32_t* src, int count, uint32_t param) {
+    (void)param;
+    span_move32(dst, src, count);
+}
+
+static void blit_row_key(uint32_t* dst, const uint32_t* src, int count, uint32_t key) {
+    span_key32(dst, src, count, key);
+}
+
+static void blit_row_over(uint32_t* dst, const uint32_t* src, int count, uint32_t param) {
+    (void)param;
+    span_over32(dst, src, count);
+}
+
+static void blit_row_fade(uint32_t* dst, const uint32_t* src, int count, uint32_t alpha) {
+    span_fade32(dst, src, count, alpha);
+}
+
+static inline uint32_t* surface_row(const gfx_surface_t* s, int y) {
+    return (uint32_t*)((uint8_t*)s->pixels + y * s->pitch);
+}
+
+// Clip a blit to the source rectangle and both surfaces, then run the row
+// kernel over it
+static void blit(gfx_surface_t* dst, int x, int y, const gfx_surface_t* src,
+                 const gfx_rect_t* src_rect, blit_row_fn row_fn, uint32_t param) {
+    int sx = 0, sy = 0, width = src->width, height = src->height;
+    if (src_rect) {
+        sx = src_rect->x;
+        sy = src_rect->y;
+        width = src_rect->width;
+        height = src_rect->height;
+    }
+    
+    // Clip the source, moving the destination along with it
+    if (sx < 0) { x -= sx; width += sx; sx = 0; }
+    if (sy < 0) { y -= sy; height += sy; sy = 0; }
+    if (sx + width > src->width) width = src->width - sx;
+    if (sy + height > src->height) height = src->height - sy;
+    
+    gfx_surface_t target;
+    int dx = x, dy = y;
+    if (!dst) {
+        gfx_target_surface(&target);
+        dst = &target;
+        if (!clip_to_active(&dx, &dy, &width, &height)) return;
+    } else {
+        if (dx < 0) { width += dx; dx = 0; }
+        if (dy < 0) { height += dy; dy = 0; }
+        if (dx + width > dst->width) width = dst->width - dx;
+        if (dy + height > dst->height) height = dst->height - dy;
+        if (width <= 0 || height <= 0) return;
+    }
+    sx += dx - x;
+    sy += dy - y;
+    pixels_blitted += width * height;
+    
+    // Walk rows away from the overlap: bottom-up when moving down within
+    // one surface
+    if (dst->pixels == src->pixels && dy > sy) {
+        for (int row = height - 1; row >= 0; row--) {
+            row_fn(surface_row(dst, dy + row) + dx, surface_row(src, sy + row) + sx, width, param);
+        }
+    } else {
+        for (int row = 0; row < height; row++) {
+            row_fn(surface_row(dst, dy + row) + dx, surface_row(src, sy + row) + sx, width, param);
+        }
+    }
+    
+    if (dst == &target) {
+        gfx_damage(dx, dy, width, height);
+    }
+}
+
+void gfx_blit(gfx_surface_t* dst, int x, int y, const gfx_surface_t* src, const gfx_rect_t* src_rect) {
+    blit(dst, x, y, src, src_rect, blit_row_copy, 0);
+}
+
+void gfx_blit_key(gfx_surface_t* dst, int x, int y, const gfx_surface_t* src, const gfx_rect_t* src_rect, uint32_t key) {
+    blit(dst, x, y, src, src_rect, blit_row_key, key);
+}
+
+void gfx_blit_over(gfx_surface_t* dst, int x, int y, const gfx_surface_t* src, const gfx_rect_t* src_rect) {
+    blit(dst, x, y, src, src_rect, blit_row_over, 0);
+}
+
+void gfx_blit_fade(gfx_surface_t* dst, int x, int y, const gfx_surface_t* src, const gfx_rect_t* src_rect, uint32_t alpha) {
+    if (alpha == 0) return;
+    if (alpha >= 255) {
+        blit(dst, x, y, src, src_rect, blit_row_copy, 0);
+    } else {
+        blit(dst, x, y, src, src_rect, blit_row_fade, alpha);
+    }
+}
+
+// Row of character c's glyph in the built-in font, as an 8-pixel cell mask
+// (bit n = column n). Its rows are one byte wide.
+static inline uint8_t font_row(unsigned char c, int row) {
+    const gfx_glyph_t* g = font_glyph(&font_5x7, c);
+    unsigned int r = (unsigned int)(row - g->top);
+    if (r >= g->height) return 0;
+    return (uint8_t)(font_5x7.bitmap[g->bitmap + r] << g->left);
+}
+
+// Write a clipped pixel without recording damage (callers damage the whole shape)
+static inline void plot_pixel(int x, int y, uint32_t color) {
+    if (x >= clip_rect.x && x < clip_rect.x + clip_rect.width &&
+        y >= clip_rect.y && y < clip_rect.y + clip_rect.height && draw_buffer) {
+        target_row(y)[x] = color;
+    }
+}
+
+void set_pixel(int x, int y, uint32_t color) {
+    plot_pixel(x, y, color);
+    gfx_damage(x, y, 1, 1);
+}
+
+void fill_rect(int x, int y, int width, int height, uint32_t color) {
+    // Clip once, then fill without per-pixel checks
+    if (!clip_to_active(&x, &y, &width, &height)) return;
+    
+    if (!draw_buffer) return;
+    
+    if (width == 1) {
+        // Columns (vertical lines, rectangle sides): step a pointer down
+        uint32_t* p = target_row(y) + x;
+        int stride = draw_pitch / 4;
+        for (int i = 0; i < height; i++, p += stride) {
+            *p = color;
+        }
+    } else {
+        // Fill row by row with the span kernel
+        for (int py = y; py < y + height; py++) {
+            span_fill32(target_row(py) + x, color, width);
+        }
+    }
+    pixels_filled += width * height;
+    gfx_damage(x, y, width, height);
+}
+
+// Fill a rectangle with one colour per row: row_colors[i] for row y + i
+// (gradients from a precomputed table)
+void fill_rect_rows(int x, int y, int width, int height, const uint32_t* row_colors) {
+    int cx = x, cy = y;
+    if (!clip_to_active(&cx, &cy, &width, &height) || !draw_buffer) return;
+    
+    row_colors += cy - y;
+    pixels_filled += width * height;
+    for (int py = cy; py < cy + height; py++) {
+        span_fill32(target_row(py) + cx, *row_colors++, width);
     }
+    gfx_damage(cx, cy, width, height);
 }
 
 void draw_rect(int x, int y, int width, int height, uint32_t color) {
-    // Top and bottom lines
-    for (int px = x; px < x + width; px++) {
-        set_pixel(px, y, color);
-        set_pixel(px, y + height - 1, color);
+    if (width <= 0 || height <= 0) return;
+    
+    // Four clipped edge fills: top and bottom spans, left and right columns
+    fill_rect(x, y, width, 1, color);
+    if (height > 1) {
+        fill_rect(x, y + height - 1, width, 1, color);
     }
-    // Left and right lines
-    for (int py = y; py < y + height; py++) {
-        set_pixel(x, py, color);
-        set_pixel(x + width - 1, py, color);
+    if (height > 2) {
+        fill_rect(x, y + 1, 1, height - 2, color);
+        if (width > 1) {
+            fill_rect(x + width - 1, y + 1, 1, height - 2, color);
+        }
     }
 }
 
+// ceil(a / b) and floor(a / b) for b > 0
+static inline int div_ceil(int a, int b) {
+    return (a >= 0) ? (a + b - 1) / b : -((-a) / b);
+}
+
+static inline int div_floor(int a, int b) {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// Horizontal and vertical lines are fills. Other lines step one pixel along
+// the major axis; after k steps the minor offset is round(k * minor / major).
+// That has a closed form, so the line is clipped by computing the first and
+// last visible step directly, and the inner loop only walks visible pixels
+// with a pointer. Lines longer than 32767 pixels are not drawn.
 void draw_line(int x1, int y1, int x2, int y2, uint32_t color) {
-    // Bresenham's line algorithm - faster than floating point
+    if (!draw_buffer) return;
+    
+    if (y1 == y2) {
+        fill_rect(x1 < x2 ? x1 : x2, y1, (x2 > x1 ? x2 - x1 : x1 - x2) + 1, 1, color);
+        return;
+    }
+    if (x1 == x2) {
+        fill_rect(x1, y1 < y2 ? y1 : y2, 1, (y2 > y1 ? y2 - y1 : y1 - y2) + 1, color);
+        return;
+    }
+    
     int dx = (x2 > x1) ? x2 - x1 : x1 - x2;
     int dy = (y2 > y1) ? y2 - y1 : y1 - y2;
     int sx = (x1 < x2) ? 1 : -1;
     int sy = (y1 < y2) ? 1 : -1;
-    int err = dx - dy;
+    if (dx > 32767 || dy > 32767) return;
+    
+    // Clip bounds as step ranges from the start point along each axis
+    int cx1 = clip_rect.x, cx2 = clip_rect.x + clip_rect.width - 1;
+    int cy1 = clip_rect.y, cy2 = clip_rect.y + clip_rect.height - 1;
+    int x_lo = (sx > 0) ? cx1 - x1 : x1 - cx2;
+    int x_hi = (sx > 0) ? cx2 - x1 : x1 - cx1;
+    int y_lo = (sy > 0) ? cy1 - y1 : y1 - cy2;
+    int y_hi = (sy > 0) ? cy2 - y1 : y1 - cy1;
+    
+    int x_major = dx >= dy;
+    int major = x_major ? dx : dy;
+    int minor = x_major ? dy : dx;
+    int k_lo = x_major ? x_lo : y_lo;
+    int k_hi = x_major ? x_hi : y_hi;
+    int j_lo = x_major ? y_lo : x_lo;
+    int j_hi = x_major ? y_hi : x_hi;
+    
+    // Steps inside the clip on the major axis ...
+    if (k_lo < 0) k_lo = 0;
+    if (k_hi > major) k_hi = major;
+    
+    // ... and those whose minor offset is inside it
+    if (j_lo < 0) j_lo = 0;
+    if (j_hi > minor) j_hi = minor;
+    if (j_lo > j_hi) return;
+    int k = div_ceil((2 * j_lo - 1) * major, 2 * minor);
+    if (k > k_lo) k_lo = k;
+    k = div_ceil((2 * j_hi + 1) * major, 2 * minor) - 1;
+    if (k < k_hi) k_hi = k;
+    if (k_lo > k_hi) return;
+    
+    // Start pixel and error term at step k_lo
+    int n = 2 * k_lo * minor + major;
+    int j = n / (2 * major);
+    int rem = n - j * 2 * major;
+    int x = x1 + sx * (x_major ? k_lo : j);
+    int y = y1 + sy * (x_major ? j : k_lo);
+    
+    int row_step = sy * (draw_pitch / 4);
+    int major_step = x_major ? sx : row_step;
+    int minor_step = x_major ? row_step : sx;
+    uint32_t* p = target_row(y) + x;
+    for (k = k_lo; k <= k_hi; k++) {
+        *p = color;
+        p += major_step;
+        rem += 2 * minor;
+        if (rem >= 2 * major) {
+            rem -= 2 * major;
+            p += minor_step;
+        }
+    }
+    
+    // Damage the box between the first and last visible pixel
+    int j_end = (2 * k_hi * minor + major) / (2 * major);
+    int x_end = x1 + sx * (x_major ? k_hi : j_end);
+    int y_end = y1 + sy * (x_major ? j_end : k_hi);
+    gfx_damage(x < x_end ? x : x_end, y < y_end ? y : y_end,
+               (x < x_end ? x_end - x : x - x_end) + 1,
+               (y < y_end ? y_end - y : y - y_end) + 1);
+}
+
+// Circles, rings, arcs and rounded rectangles are one shape: the box of
+// corner centres [x0, x1] x [y0, y1] grown by a radius, less a hole grown
+// the same way from a smaller box. Every row is then at most two spans.
+#define GFX_MAX_RADIUS 1024
+
+// Row half-widths of a quarter circle, from a midpoint walk: widths[d] is
+// the largest x with x*x + d*d <= r*r + r, i.e. inside radius r + 1/2
+static int round_outer[GFX_MAX_RADIUS + 1];
+static int round_inner[GFX_MAX_RADIUS + 1];
+
+static void round_widths(int* widths, int r) {
+    int x = r;
+    for (int d = 0; d <= r; d++) {
+        while (x * x + d * d > r * r + r) x--;
+        widths[d] = x;
+    }
+}
+
+// sin of whole degrees 0..90 in 2.14 fixed point
+static const int16_t sin_table[91] = {
+    0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563,
+    2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+    5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943,
+    8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+    12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+    16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+    16384
+};
+
+static int sin_deg(int a) {
+    a %= 360;
+    if (a < 0) a += 360;
+    if (a <= 90) return sin_table[a];
+    if (a <= 180) return sin_table[180 - a];
+    if (a <= 270) return -sin_table[a - 180];
+    return -sin_table[360 - a];
+}
+
+// Angular limit of an arc around (cx, cy): up to two sectors of at most
+// 180 degrees, each the points clockwise of from and anticlockwise of to
+typedef struct {
+    int cx, cy;
+    int count;
+    int from_x[2], from_y[2];
+    int to_x[2], to_y[2];
+} round_arc_t;
+
+// Direction of angle a, clockwise from 12 o'clock (y grows downwards)
+static void angle_dir(int a, int* x, int* y) {
+    *x = sin_deg(a);
+    *y = -sin_deg(a + 90);
+}
+
+// Narrow [*lo, *hi] to the x with a * x <= b
+static void limit_half_plane(int a, int b, int* lo, int* hi) {
+    if (a > 0) {
+        int m = div_floor(b, a);
+        if (m < *hi) *hi = m;
+    } else if (a < 0) {
+        int m = div_ceil(-b, -a);
+        if (m > *lo) *lo = m;
+    } else if (b < 0) {
+        *hi = *lo - 1;
+    }
+}
+
+// Fill [x0, x1] on row y, limited to the clip and to arc if given
+static void round_span(int x0, int x1, int y, uint32_t color, const round_arc_t* arc) {
+    if (x0 < clip_rect.x) x0 = clip_rect.x;
+    if (x1 > clip_rect.x + clip_rect.width - 1) x1 = clip_rect.x + clip_rect.width - 1;
+    if (x0 > x1) return;
     
-    int x = x1, y = y1;
+    if (!arc) {
+        span_fill32(target_row(y) + x0, color, x1 - x0 + 1);
+        pixels_filled += x1 - x0 + 1;
+        return;
+    }
     
-    while (1) {
-        set_pixel(x, y, color);
+    // Each sector edge is a half-plane through the centre, which cuts the
+    // row at one x; sectors may share an edge column, filled twice
+    int py = y - arc->cy;
+    for (int i = 0; i < arc->count; i++) {
+        int lo = x0 - arc->cx, hi = x1 - arc->cx;
+        limit_half_plane(arc->from_y[i], arc->from_x[i] * py, &lo, &hi);
+        limit_half_plane(-arc->to_y[i], -arc->to_x[i] * py, &lo, &hi);
+        if (lo <= hi) {
+            span_fill32(target_row(y) + arc->cx + lo, color, hi - lo + 1);
+            pixels_filled += hi - lo + 1;
+        }
+    }
+}
+
+// Rasterize the box [x0, x1] x [y0, y1] grown by r. With thickness > 0 the
+// box inset by thickness and grown by what is left of r is cut out, giving
+// a ring or outline; thickness <= 0 fills.
+static void round_shape(int x0, int y0, int x1, int y1, int r, int thickness,
+                        uint32_t color, const round_arc_t* arc) {
+    if (!draw_buffer || r < 0) return;
+    if (r > GFX_MAX_RADIUS) r = GFX_MAX_RADIUS;
+    
+    // Only rows inside the clip are walked
+    int bx = x0 - r, by = y0 - r;
+    int bw = x1 - x0 + 2 * r + 1, bh = y1 - y0 + 2 * r + 1;
+    if (!clip_to_active(&bx, &by, &bw, &bh)) return;
+    
+    int inset = (thickness > r) ? thickness - r : 0;
+    int ri = (thickness < r) ? r - thickness : 0;
+    int hx0 = x0 + inset, hx1 = x1 - inset;
+    int hy0 = y0 + inset, hy1 = y1 - inset;
+    int hole = thickness > 0 && hx0 <= hx1 && hy0 <= hy1;
+    
+    round_widths(round_outer, r);
+    if (hole) round_widths(round_inner, ri);
+    
+    for (int y = by; y < by + bh; y++) {
+        int d = (y < y0) ? y0 - y : (y > y1) ? y - y1 : 0;
+        int left = x0 - round_outer[d], right = x1 + round_outer[d];
         
-        if (x == x2 && y == y2) break;
+        int di = (y < hy0) ? hy0 - y : (y > hy1) ? y - hy1 : 0;
+        if (!hole || di > ri) {
+            round_span(left, right, y, color, arc);
+        } else {
+            round_span(left, hx0 - round_inner[di] - 1, y, color, arc);
+            round_span(hx1 + round_inner[di] + 1, right, y, color, arc);
+        }
+    }
+    gfx_damage(bx, by, bw, bh);
+}
+
+void fill_circle(int cx, int cy, int r, uint32_t color) {
+    round_shape(cx, cy, cx, cy, r, 0, color, 0);
+}
+
+void draw_circle(int cx, int cy, int r, uint32_t color) {
+    draw_ring(cx, cy, r, 1, color);
+}
+
+void draw_ring(int cx, int cy, int r, int thickness, uint32_t color) {
+    if (thickness <= 0) return;
+    
+    // A hole of radius 0 would still be the centre pixel
+    if (thickness >= r) thickness = 0;
+    round_shape(cx, cy, cx, cy, r, thickness, color, 0);
+}
+
+void draw_arc(int cx, int cy, int r, int thickness, int start, int sweep, uint32_t color) {
+    if (thickness <= 0 || sweep <= 0) return;
+    if (sweep >= 360) {
+        draw_ring(cx, cy, r, thickness, color);
+        return;
+    }
+    if (thickness >= r) thickness = 0;
+    
+    // Sweeps over a half turn are split in two sectors
+    round_arc_t arc;
+    arc.cx = cx;
+    arc.cy = cy;
+    arc.count = (sweep > 180) ? 2 : 1;
+    angle_dir(start, &arc.from_x[0], &arc.from_y[0]);
+    angle_dir(start + (sweep > 180 ? 180 : sweep), &arc.to_x[0], &arc.to_y[0]);
+    angle_dir(start + 180, &arc.from_x[1], &arc.from_y[1]);
+    angle_dir(start + sweep, &arc.to_x[1], &arc.to_y[1]);
+    round_shape(cx, cy, cx, cy, r, thickness, color, &arc);
+}
+
+// Corner radii are limited to half the shorter side
+static int round_rect_radius(int width, int height, int radius) {
+    int limit = ((width < height ? width : height) - 1) / 2;
+    if (radius > limit) radius = limit;
+    return (radius < 0) ? 0 : radius;
+}
+
+void fill_round_rect(int x, int y, int width, int height, int radius, uint32_t color) {
+    if (width <= 0 || height <= 0) return;
+    
+    int r = round_rect_radius(width, height, radius);
+    round_shape(x + r, y + r, x + width - 1 - r, y + height - 1 - r, r, 0, color, 0);
+}
+
+void draw_round_rect(int x, int y, int width, int height, int radius, uint32_t color) {
+    if (width <= 0 || height <= 0) return;
+    
+    int r = round_rect_radius(width, height, radius);
+    round_shape(x + r, y + r, x + width - 1 - r, y + height - 1 - r, r, 1, color, 0);
+}
+
+// Glyph row expansion table: byte -> 8 pixel masks (bit n selects column n)
+static uint32_t glyph_masks[256][8] __attribute__((aligned(16)));
+static int glyph_masks_ready = 0;
+
+static void glyph_masks_init(void) {
+    for (int b = 0; b < 256; b++) {
+        for (int col = 0; col < 8; col++) {
+            glyph_masks[b][col] = (b & (1 << col)) ? 0xFFFFFFFF : 0;
+        }
+    }
+    glyph_masks_ready = 1;
+}
+
+// Text run cache. Runs of TEXT_CACHE_MIN..TEXT_CACHE_MAX characters are
+// rasterized once into an entry and then drawn with a single blit
+// (colour-keyed for transparent text). The least recently used entry is
+// replaced on a miss.
+#define GFX_FONT_5X7        0   // The only font: font_5x7, 8x7 cells
+#define TEXT_CACHE_ENTRIES  32
+#define TEXT_CACHE_MIN      2
+#define TEXT_CACHE_MAX      64
+#define TEXT_HEIGHT         7
+
+typedef struct {
+    uint32_t hash;
+    uint32_t last_use;          // 0: empty
+    int font;
+    uint32_t fg, bg;            // bg is the colour key for transparent runs
+    int transparent;
+    int count;
+    char text[TEXT_CACHE_MAX];
+    uint32_t pixels[TEXT_CACHE_MAX * 8 * TEXT_HEIGHT];
+} text_cache_entry_t;
+
+static text_cache_entry_t text_cache[TEXT_CACHE_ENTRIES];
+static uint32_t text_cache_clock = 0;
+static uint32_t text_cache_hits = 0;
+static uint32_t text_cache_misses = 0;
+
+void gfx_text_cache_stats(uint32_t* hits, uint32_t* misses) {
+    if (hits) *hits = text_cache_hits;
+    if (misses) *misses = text_cache_misses;
+}
+
+// FNV-1a over the characters of a run
+static uint32_t text_hash(const char* str, int count) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < count; i++) {
+        h = (h ^ (unsigned char)str[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Find or render the cache entry for a run; returns 0 if it is not cacheable
+static text_cache_entry_t* text_cache_lookup(const char* str, int count, uint32_t fg,
+                                             uint32_t bg, int transparent) {
+    if (count < TEXT_CACHE_MIN || count > TEXT_CACHE_MAX) return 0;
+    
+    // Transparent runs key out a colour that cannot be the foreground
+    if (transparent) bg = fg ^ 0x00FFFFFF;
+    
+    uint32_t hash = text_hash(str, count);
+    text_cache_entry_t* victim = &text_cache[0];
+    for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+        text_cache_entry_t* e = &text_cache[i];
+        if (e->last_use && e->hash == hash && e->font == GFX_FONT_5X7 &&
+            e->fg == fg && e->bg == bg && e->transparent == transparent &&
+            e->count == count) {
+            int same = 1;
+            for (int c = 0; c < count && same; c++) {
+                same = (e->text[c] == str[c]);
+            }
+            if (same) {
+                e->last_use = ++text_cache_clock;
+                text_cache_hits++;
+                return e;
+            }
+        }
+        if (e->last_use < victim->last_use) {
+            victim = e;
+        }
+    }
+    
+    // Miss: rasterize the run into the least recently used entry
+    text_cache_misses++;
+    victim->hash = hash;
+    victim->last_use = ++text_cache_clock;
+    victim->font = GFX_FONT_5X7;
+    victim->fg = fg;
+    victim->bg = bg;
+    victim->transparent = transparent;
+    victim->count = count;
+    for (int c = 0; c < count; c++) {
+        victim->text[c] = str[c];
+    }
+    for (int row = 0; row < TEXT_HEIGHT; row++) {
+        uint32_t* line = victim->pixels + row * count * 8;
+        for (int c = 0; c < count; c++) {
+            uint8_t bits = font_row(str[c], row);
+            span_expand8(line + c * 8, glyph_masks[bits], fg, bg);
+        }
+    }
+    return victim;
+}
+
+// Render count characters on one text line. Rows are the outer loop so each
+// scanline pointer is computed once per line; whole 8-pixel glyph rows go
+// through the SIMD select kernels and only cells cut by the screen edge fall
+// back to a per-pixel loop.
+static void draw_text_run(int x, int y, const char* str, int count,
+                          uint32_t fg, uint32_t bg, int transparent) {
+    if (!draw_buffer || count <= 0) return;
+    if (!glyph_masks_ready) glyph_masks_init();
+    
+    // Repeated strings come from the cache as one blit
+    text_cache_entry_t* cached = text_cache_lookup(str, count, fg, bg, transparent);
+    if (cached) {
+        gfx_surface_t run = {cached->pixels, count * 8, TEXT_HEIGHT, count * 8 * 4};
+        if (transparent) {
+            gfx_blit_key(0, x, y, &run, 0, cached->bg);
+        } else {
+            gfx_blit(0, x, y, &run, 0);
+        }
+        return;
+    }
+    
+    // Clip rows and character cells once
+    int clip_x1 = clip_rect.x;
+    int clip_x2 = clip_rect.x + clip_rect.width;
+    int row0 = (y < clip_rect.y) ? clip_rect.y - y : 0;
+    int row1 = (y + 7 > clip_rect.y + clip_rect.height) ? clip_rect.y + clip_rect.height - y : 7;
+    int first = 0;
+    int last = count;
+    while (first < last && x + first * 8 + 8 <= clip_x1) first++;
+    while (last > first && x + (last - 1) * 8 >= clip_x2) last--;
+    if (row0 >= row1 || first >= last) return;
+    
+    for (int row = row0; row < row1; row++) {
+        uint32_t* line = target_row(y + row);
+        int cx = x + first * 8;
         
-        int e2 = 2 * err;
-        if (e2 > -dy) {
-            err = err - dy;
-            x = x + sx;
+        for (int i = first; i < last; i++, cx += 8) {
+            uint8_t bits = font_row(str[i], row);
+            if (transparent && !bits) continue;
+            
+            const uint32_t* mask = glyph_masks[bits];
+            if (cx >= clip_x1 && cx + 8 <= clip_x2) {
+                if (transparent) {
+                    span_expand8_over(line + cx, mask, fg);
+                } else {
+                    span_expand8(line + cx, mask, fg, bg);
+                }
+            } else {
+                int c0 = (cx < clip_x1) ? clip_x1 - cx : 0;
+                int c1 = (cx + 8 > clip_x2) ? clip_x2 - cx : 8;
+                for (int col = c0; col < c1; col++) {
+                    uint32_t under = transparent ? line[cx + col] : bg;
+                    line[cx + col] = (fg & mask[col]) | (under & ~mask[col]);
+                }
+            }
         }
-        if (e2 < dx) {
-            err = err + dx;
-            y = y + sy;
+    }
+    
+    gfx_damage(x + first * 8, y + row0, (last - first) * 8, row1 - row0);
+}
+
+// Scaled text is drawn as runs of identical pixels: each glyph row of the
+// line is turned into clipped runs once, and those are span-filled on each
+// of its scale scanlines. Runs continue across character cells.
+#define SCALED_RUNS_MAX 512
+
+typedef struct {
+    int x, width;
+    uint32_t color;
+} text_span_t;
+
+static text_span_t scaled_runs[SCALED_RUNS_MAX];
+
+// Fill rows [y0, y1) with the first count scaled runs
+static void scaled_runs_fill(int count, int y0, int y1) {
+    for (int py = y0; py < y1; py++) {
+        uint32_t* line = target_row(py);
+        for (int i = 0; i < count; i++) {
+            span_fill32(line + scaled_runs[i].x, scaled_runs[i].color, scaled_runs[i].width);
         }
     }
 }
 
-void draw_char(int x, int y, char c, uint32_t fg, uint32_t bg) {
-    if (!framebuffer) return;
+// Render count characters on one text line with scale x scale pixel blocks
+static void draw_text_run_scaled(int x, int y, const char* str, int count, int scale,
+                                 uint32_t fg, uint32_t bg, int transparent) {
+    if (!draw_buffer || count <= 0) return;
     
-    const uint8_t* char_data = font_data[(unsigned char)c];
+    int clip_x1 = clip_rect.x;
+    int clip_x2 = clip_rect.x + clip_rect.width;
+    int clip_y1 = clip_rect.y;
+    int clip_y2 = clip_rect.y + clip_rect.height;
+    int cell = 8 * scale;
     
-    for (int row = 0; row < 7; row++) {
-        uint8_t byte = char_data[row];
-        uint32_t* fb_row = (uint32_t*)((uint8_t*)framebuffer + (y + row) * pitch) + x;
+    // Character cells inside the clip
+    int first = 0;
+    int last = count;
+    while (first < last && x + first * cell + cell <= clip_x1) first++;
+    while (last > first && x + (last - 1) * cell >= clip_x2) last--;
+    if (first >= last) return;
+    
+    int drawn_y1 = clip_y2, drawn_y2 = clip_y1;
+    for (int row = 0; row < TEXT_HEIGHT; row++) {
+        int y0 = y + row * scale;
+        int y1 = y0 + scale;
+        if (y0 < clip_y1) y0 = clip_y1;
+        if (y1 > clip_y2) y1 = clip_y2;
+        if (y0 >= y1) continue;
+        if (y0 < drawn_y1) drawn_y1 = y0;
+        if (y1 > drawn_y2) drawn_y2 = y1;
         
-        for (int col = 0; col < 8; col++) {
-            fb_row[col] = (byte & (1 << col)) ? fg : bg;
+        // Expand the glyph row into runs of equal bits, clipped to the clip
+        int runs = 0;
+        int run_x = x + first * cell;
+        int run_on = font_row(str[first], row) & 1;
+        for (int i = first; i <= last; i++) {
+            uint8_t bits = (i < last) ? font_row(str[i], row) : 0;
+            for (int col = 0; col < 8; col++) {
+                int px = x + i * cell + col * scale;
+                int on = (bits >> col) & 1;
+                if (on == run_on && i < last) continue;
+                
+                // Close the run that ends at px
+                int rx1 = (run_x < clip_x1) ? clip_x1 : run_x;
+                int rx2 = (px > clip_x2) ? clip_x2 : px;
+                if (rx1 < rx2 && (run_on || !transparent)) {
+                    if (runs == SCALED_RUNS_MAX) {
+                        scaled_runs_fill(runs, y0, y1);
+                        runs = 0;
+                    }
+                    scaled_runs[runs].x = rx1;
+                    scaled_runs[runs].width = rx2 - rx1;
+                    scaled_runs[runs].color = run_on ? fg : bg;
+                    runs++;
+                }
+                if (i == last) break;
+                run_x = px;
+                run_on = on;
+            }
         }
+        scaled_runs_fill(runs, y0, y1);
+    }
+    
+    if (drawn_y1 < drawn_y2) {
+        int dx1 = x + first * cell, dx2 = x + last * cell;
+        if (dx1 < clip_x1) dx1 = clip_x1;
+        if (dx2 > clip_x2) dx2 = clip_x2;
+        gfx_damage(dx1, drawn_y1, dx2 - dx1, drawn_y2 - drawn_y1);
     }
 }
 
-void draw_string(int x, int y, const char* str, uint32_t fg, uint32_t bg) {
+// Split a string into screen-width lines and render each as one run
+static void draw_text(int x, int y, const char* str, int scale, uint32_t fg, uint32_t bg,
+                      int transparent) {
     if (!str) return;
+    if (scale < 1) scale = 1;
+    
+    int len = strlen(str);
+    
+    // Characters that fit before wrapping (at least one per line); surfaces
+    // take the whole string on one line
+    int per_line = surface_target ? len : (screen_width - x) / (8 * scale);
+    if (per_line < 1) per_line = 1;
     
-    int x_pos = x;
-    while (*str) {
-        if (x_pos + 8 > screen_width) {
-            // Wrap to next line
-            x_pos = x;
-            y += 8;
+    while (len > 0) {
+        int n = (len < per_line) ? len : per_line;
+        if (scale == 1) {
+            draw_text_run(x, y, str, n, fg, bg, transparent);
+        } else {
+            draw_text_run_scaled(x, y, str, n, scale, fg, bg, transparent);
         }
-        draw_char(x_pos, y, *str, fg, bg);
-        x_pos += 8;
-        str++;
+        str += n;
+        len -= n;
+        y += 8 * scale;
     }
 }
 
+void draw_char(int x, int y, char c, uint32_t fg, uint32_t bg) {
+    draw_text_run(x, y, &c, 1, fg, bg, 0);
+}
+
+void draw_char_transparent(int x, int y, char c, uint32_t fg) {
+    draw_text_run(x, y, &c, 1, fg, 0, 1);
+}
+
+void draw_string(int x, int y, const char* str, uint32_t fg, uint32_t bg) {
+    draw_text(x, y, str, 1, fg, bg, 0);
+}
+
+void draw_string_transparent(int x, int y, const char* str, uint32_t fg) {
+    draw_text(x, y, str, 1, fg, 0, 1);
+}
+
+void draw_string_scaled(int x, int y, const char* str, int scale, uint32_t fg, uint32_t bg) {
+    draw_text(x, y, str, scale, fg, bg, 0);
+}
+
+void draw_string_scaled_transparent(int x, int y, const char* str, int scale, uint32_t fg) {
+    draw_text(x, y, str, scale, fg, 0, 1);
+}
+
 void clear_screen(uint32_t color) {
     fill_rect(0, 0, screen_width, screen_height, color);
 }
@@ -199,16 +1279,13 @@ void draw_wallpaper() {
     // Simple fast wallpaper with alternating colors (ARGB format)
     uint32_t colors[4] = {0xFF1a4d6d, 0xFF0d3d52, 0xFF2a5f7f, 0xFF1a4d6d};
     
-    if (!framebuffer) return;
+    if (!draw_buffer) return;
     
-    for (int y = 0; y < screen_height; y++) {
-        uint32_t color = colors[(y / 4) % 4];
-        uint32_t* row = (uint32_t*)((uint8_t*)framebuffer + y * pitch);
-        
-        for (int x = 0; x < screen_width; x++) {
-            row[x] = color;
-        }
+    for (int y = clip_rect.y; y < clip_rect.y + clip_rect.height; y++) {
+        span_fill32(target_row(y) + clip_rect.x, colors[(y / 4) % 4], clip_rect.width);
     }
+    
+    gfx_damage(clip_rect.x, clip_rect.y, clip_rect.width, clip_rect.height);
 }
 
 void draw_window(window_t* win) {
@@ -241,24 +1318,25 @@ void draw_taskbar(uint32_t color) {
     draw_string(5, taskbar_y + 8, "FLUX-OS", COLOR_WHITE, color);
 }
 
-// 16x16 arrow cursor bitmap
+// 16x16 arrow cursor: mask bits are drawn, in black where the outline
+// bit is set and white elsewhere
 static const uint8_t cursor_bitmap[16][4] = {
     {0x80, 0x00, 0x00, 0x00},  // Row 0
     {0xC0, 0x00, 0x00, 0x00},  // Row 1
-    {0xE0, 0x00, 0x00, 0x00},  // Row 2
-    {0xF0, 0x00, 0x00, 0x00},  // Row 3
-    {0xF8, 0x00, 0x00, 0x00},  // Row 4
-    {0xFC, 0x00, 0x00, 0x00},  // Row 5
-    {0xFE, 0x00, 0x00, 0x00},  // Row 6
-    {0xFF, 0x00, 0x00, 0x00},  // Row 7
-    {0xFC, 0x00, 0x00, 0x00},  // Row 8
-    {0xF8, 0x00, 0x00, 0x00},  // Row 9
-    {0xF0, 0x80, 0x00, 0x00},  // Row 10
-    {0xE0, 0xC0, 0x00, 0x00},  // Row 11
-    {0xC0, 0xE0, 0x00, 0x00},  // Row 12
-    {0x80, 0xF0, 0x00, 0x00},  // Row 13
-    {0x00, 0xF8, 0x00, 0x00},  // Row 14
-    {0x00, 0xF0, 0x80, 0x00},  // Row 15
+    {0xA0, 0x00, 0x00, 0x00},  // Row 2
+    {0x90, 0x00, 0x00, 0x00},  // Row 3
+    {0x88, 0x00, 0x00, 0x00},  // Row 4
+    {0x84, 0x00, 0x00, 0x00},  // Row 5
+    {0x82, 0x00, 0x00, 0x00},  // Row 6
+    {0x81, 0x00, 0x00, 0x00},  // Row 7
+    {0x80, 0x80, 0x00, 0x00},  // Row 8
+    {0x81, 0xC0, 0x00, 0x00},  // Row 9
+    {0x92, 0x00, 0x00, 0x00},  // Row 10
+    {0xA9, 0x00, 0x00, 0x00},  // Row 11
+    {0xC5, 0x00, 0x00, 0x00},  // Row 12
+    {0x84, 0x80, 0x00, 0x00},  // Row 13
+    {0x02, 0x80, 0x00, 0x00},  // Row 14
+    {0x01, 0x00, 0x00, 0x00},  // Row 15
 };
 
 // Mask for cursor (transparency)
@@ -271,84 +1349,64 @@ static const uint8_t cursor_mask[16][4] = {
     {0xFC, 0x00, 0x00, 0x00},
     {0xFE, 0x00, 0x00, 0x00},
     {0xFF, 0x00, 0x00, 0x00},
-    {0xFC, 0x00, 0x00, 0x00},
-    {0xF8, 0x00, 0x00, 0x00},
-    {0xF0, 0x80, 0x00, 0x00},
-    {0xE0, 0xC0, 0x00, 0x00},
-    {0xC0, 0xE0, 0x00, 0x00},
-    {0x80, 0xF0, 0x00, 0x00},
-    {0x00, 0xF8, 0x00, 0x00},
-    {0x00, 0xF0, 0x80, 0x00},
+    {0xFF, 0x80, 0x00, 0x00},
+    {0xFF, 0xC0, 0x00, 0x00},
+    {0xFE, 0x00, 0x00, 0x00},
+    {0xEF, 0x00, 0x00, 0x00},
+    {0xC7, 0x00, 0x00, 0x00},
+    {0x87, 0x80, 0x00, 0x00},
+    {0x03, 0x80, 0x00, 0x00},
+    {0x01, 0x00, 0x00, 0x00},
 };
 
-// Draw mouse cursor at position
-void draw_mouse_cursor(int x, int y) {
-    if (!framebuffer) return;
-    
-    // Save background first if visible
-    if (!cursor_visible) {
-        for (int py = 0; py < 16; py++) {
-            if (y + py >= 0 && y + py < screen_height) {
-                for (int px = 0; px < 16; px++) {
-                    if (x + px >= 0 && x + px < screen_width) {
-                        uint32_t* pixel = (uint32_t*)((uint8_t*)framebuffer + (y + py) * pitch) + (x + px);
-                        cursor_bg[py][px] = *pixel;
-                    }
-                }
-            }
-        }
-    }
-    
-    // Draw cursor
+// Put the cursor into the back buffer, saving the pixels it covers, or
+// (restore) put those pixels back. Only the masked pixels are touched.
+static void cursor_swap(int restore) {
     for (int py = 0; py < 16; py++) {
-        if (y + py >= 0 && y + py < screen_height) {
-            for (int px = 0; px < 16; px++) {
-                if (x + px >= 0 && x + px < screen_width) {
-                    // Check mask bit
-                    int byte_idx = px / 8;
-                    int bit_idx = 7 - (px % 8);
-                    
-                    if (cursor_mask[py][byte_idx] & (1 << bit_idx)) {
-                        uint32_t* pixel = (uint32_t*)((uint8_t*)framebuffer + (y + py) * pitch) + (x + px);
-                        // Cursor color: white with black outline
-                        if (cursor_bitmap[py][byte_idx] & (1 << bit_idx)) {
-                            *pixel = COLOR_BLACK;
-                        } else {
-                            *pixel = COLOR_WHITE;
-                        }
-                    }
-                }
+        int y = cursor_y + py;
+        if (y < 0 || y >= screen_height) continue;
+        uint32_t* row = back_buffer + y * screen_width;
+        
+        for (int px = 0; px < 16; px++) {
+            int x = cursor_x + px;
+            uint8_t bit = 0x80 >> (px & 7);
+            if (x < 0 || x >= screen_width || !(cursor_mask[py][px >> 3] & bit)) continue;
+            
+            if (restore) {
+                row[x] = cursor_bg[py][px];
+            } else {
+                cursor_bg[py][px] = row[x];
+                row[x] = (cursor_bitmap[py][px >> 3] & bit) ? COLOR_BLACK : COLOR_WHITE;
             }
         }
     }
+}
+
+// Move the cursor to (x, y), showing it if hidden. Only its old and new
+// cells are damaged; the scene underneath is not redrawn.
+void draw_mouse_cursor(int x, int y) {
+    if (cursor_visible && x == cursor_x && y == cursor_y) return;
     
+    if (cursor_visible) {
+        gfx_damage(cursor_x, cursor_y, 16, 16);
+    }
     cursor_x = x;
     cursor_y = y;
     cursor_visible = 1;
+    gfx_damage(x, y, 16, 16);
 }
 
 // Hide mouse cursor
 void hide_mouse_cursor(void) {
-    if (!framebuffer || !cursor_visible) return;
-    
-    // Restore background
-    for (int py = 0; py < 16; py++) {
-        if (cursor_y + py >= 0 && cursor_y + py < screen_height) {
-            for (int px = 0; px < 16; px++) {
-                if (cursor_x + px >= 0 && cursor_x + px < screen_width) {
-                    uint32_t* pixel = (uint32_t*)((uint8_t*)framebuffer + (cursor_y + py) * pitch) + (cursor_x + px);
-                    *pixel = cursor_bg[py][px];
-                }
-            }
-        }
-    }
+    if (!cursor_visible) return;
     
+    gfx_damage(cursor_x, cursor_y, 16, 16);
     cursor_visible = 0;
 }
 
 // Show mouse cursor
 void show_mouse_cursor(void) {
-    if (framebuffer && !cursor_visible) {
+    if (!cursor_visible) {
         draw_mouse_cursor(cursor_x, cursor_y);
     }
 }
@@ -26,19 +26,141 @@
 #define COLOR_BUTTON_HOVER 0xFFE8E8E8
 #define COLOR_BORDER    0xFF808080
 
+// Largest mode rendered through the off-screen back buffer; bigger modes
+// draw directly into the framebuffer
+#ifndef GFX_BACKBUFFER_MAX_WIDTH
+#define GFX_BACKBUFFER_MAX_WIDTH  1920
+#endif
+#ifndef GFX_BACKBUFFER_MAX_HEIGHT
+#define GFX_BACKBUFFER_MAX_HEIGHT 1080
+#endif
+
+// Screen rectangle
+typedef struct {
+    int x, y;
+    int width, height;
+} gfx_rect_t;
+
+// Framebuffer pixel formats. Drawing always happens in 32-bit XRGB (the
+// COLOR_* values) in the back buffer; gfx_present() packs it into the
+// framebuffer's format.
+typedef enum {
+    GFX_FORMAT_XRGB8888 = 0,    // 0x00RRGGBB words
+    GFX_FORMAT_XBGR8888,        // 0x00BBGGRR words
+    GFX_FORMAT_RGB565,          // 16-bit 5:6:5
+    GFX_FORMAT_PAL8             // 8-bit index into a fixed 3-3-2 palette
+} gfx_format_t;
+
+// Framebuffer format for the next gfx_init() (XRGB8888 until set)
+void gfx_set_format(gfx_format_t format);
+
+// Color of a GFX_FORMAT_PAL8 index, for loading the hardware palette
+uint32_t gfx_palette_color(int index);
+
 // Graphics initialization (for ARM framebuffer)
 void gfx_init(int width, int height, void* fb, int fb_pitch);
 
+// Size of the drawn area, which gfx_init() may clamp to the back buffer
+void gfx_get_size(int* width, int* height);
+
+// Clip stack honoured by every drawing primitive
+void gfx_push_clip(int x, int y, int width, int height);
+void gfx_pop_clip(void);
+void gfx_reset_clip(void);
+void gfx_get_clip(gfx_rect_t* rect);
+
+// Damage tracking and presentation
+void gfx_damage(int x, int y, int width, int height);
+void gfx_present(void);
+
+// Whether anything has been damaged since the last present, anywhere or
+// within a rectangle
+int gfx_damage_pending(void);
+int gfx_damage_overlaps(int x, int y, int width, int height);
+
+// Page flipping. The framebuffer passed to gfx_init() is page 0 and is on
+// screen; flip(page) must make the given page the one scanned out. Once
+// enabled, gfx_present() updates the hidden page and swaps.
+typedef void (*gfx_flip_fn)(int page);
+void gfx_enable_page_flip(void* second_page, gfx_flip_fn flip);
+
+// Tile-hash presentation (off by default): gfx_present() splits damage into
+// 64x64 tiles, hashes each one and only copies tiles whose pixels differ
+// from what the framebuffer last received. Repainting identical pixels then
+// costs a read of the back buffer instead of framebuffer writes.
+void gfx_set_tile_hashing(int enabled);
+// Tiles hashed and copied by presents since boot
+void gfx_tile_stats(uint32_t* hashed, uint32_t* copied);
+
+// Pixels written since boot by fills (rectangles, shapes) and by blits
+void gfx_pixel_stats(uint32_t* filled, uint32_t* blitted);
+
 // Basic drawing functions
 void set_pixel(int x, int y, uint32_t color);
 void fill_rect(int x, int y, int width, int height, uint32_t color);
 void draw_rect(int x, int y, int width, int height, uint32_t color);
+void fill_rect_rows(int x, int y, int width, int height, const uint32_t* row_colors);
 void draw_line(int x1, int y1, int x2, int y2, uint32_t color);
 void draw_char(int x, int y, char c, uint32_t fg, uint32_t bg);
 void draw_string(int x, int y, const char* str, uint32_t fg, uint32_t bg);
+void draw_char_transparent(int x, int y, char c, uint32_t fg);
+void draw_string_transparent(int x, int y, const char* str, uint32_t fg);
 void clear_screen(uint32_t color);
 
-// Mouse cursor functions
+// Text magnified scale times: each font pixel becomes a scale x scale block
+// and lines advance by 8 * scale
+void draw_string_scaled(int x, int y, const char* str, int scale, uint32_t fg, uint32_t bg);
+void draw_string_scaled_transparent(int x, int y, const char* str, int scale, uint32_t fg);
+
+// Curved shapes, drawn as horizontal spans. Radii are measured to pixel
+// centres (up to 1024); a ring's thickness is inward from radius r. Arcs
+// cover sweep degrees clockwise from start, with 0 at 12 o'clock.
+void fill_circle(int cx, int cy, int r, uint32_t color);
+void draw_circle(int cx, int cy, int r, uint32_t color);
+void draw_ring(int cx, int cy, int r, int thickness, uint32_t color);
+void draw_arc(int cx, int cy, int r, int thickness, int start, int sweep, uint32_t color);
+void fill_round_rect(int x, int y, int width, int height, int radius, uint32_t color);
+void draw_round_rect(int x, int y, int width, int height, int radius, uint32_t color);
+
+// Rendered text runs are kept in a small LRU cache and redrawn with one
+// blit; these count lookups since boot
+void gfx_text_cache_stats(uint32_t* hits, uint32_t* misses);
+
+// Overlap-safe block copy within the render target
+void gfx_copy_rect(int src_x, int src_y, int width, int height, int dst_x, int dst_y);
+
+// Image in memory: 32-bit ARGB pixels, rows pitch bytes apart
+typedef struct {
+    uint32_t* pixels;
+    int width, height;
+    int pitch;
+} gfx_surface_t;
+
+// The current render target as a surface
+void gfx_target_surface(gfx_surface_t* surface);
+
+// Redirect drawing into surface, whose pixel (0, 0) appears at (x, y) in
+// drawing coordinates; the clip is the surface's area and no damage is
+// recorded. Text is not wrapped at the screen edge, so what is drawn does
+// not depend on where the surface is later shown. Does not nest.
+void gfx_begin_surface(gfx_surface_t* surface, int x, int y);
+void gfx_end_surface(void);
+
+// Blits: copy the part of src inside src_rect (all of src if 0) to (x, y)
+// in dst, clipped to both surfaces. dst 0 means the render target, where
+// the clip stack applies and the result is damaged. Only the opaque copy
+// may overlap its own source.
+void gfx_blit(gfx_surface_t* dst, int x, int y, const gfx_surface_t* src, const gfx_rect_t* src_rect);
+// Skip source pixels equal to key
+void gfx_blit_key(gfx_surface_t* dst, int x, int y, const gfx_surface_t* src, const gfx_rect_t* src_rect, uint32_t key);
+// Composite a premultiplied-alpha source over dst
+void gfx_blit_over(gfx_surface_t* dst, int x, int y, const gfx_surface_t* src, const gfx_rect_t* src_rect);
+// Blend src at a constant alpha (0 = invisible, 255 = opaque copy)
+void gfx_blit_fade(gfx_surface_t* dst, int x, int y, const gfx_surface_t* src, const gfx_rect_t* src_rect, uint32_t alpha);
+
+// Mouse cursor, composited over the back buffer by each present (so it
+// needs the back buffer). draw_mouse_cursor() moves it and shows it; either
+// way only its old and new 16x16 cells are damaged.
 void draw_mouse_cursor(int x, int y);
 void hide_mouse_cursor(void);
 void show_mouse_cursor(void);
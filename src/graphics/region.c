@@ -0,0 +1,527 @@
+#include "region.h"
+
+// Box pool: fixed storage handed out in runs of chunks
+#define REGION_POOL_BOXES   8192
+#define REGION_CHUNK_BOXES  16
+#define REGION_POOL_CHUNKS  (REGION_POOL_BOXES / REGION_CHUNK_BOXES)
+
+#define REGION_INF 0x7FFFFFFF
+
+static region_box_t region_pool[REGION_POOL_BOXES];
+static uint8_t chunk_used[REGION_POOL_CHUNKS];
+static int pool_used_boxes = 0;
+
+typedef enum {
+    REGION_OP_UNION,
+    REGION_OP_INTERSECT,
+    REGION_OP_SUBTRACT
+} region_op_t;
+
+// Allocate contiguous chunks for at least 'boxes' boxes (first fit).
+// Returns the first chunk index, or -1 when the pool is exhausted.
+static int pool_alloc(int boxes, int* capacity) {
+    int need = (boxes + REGION_CHUNK_BOXES - 1) / REGION_CHUNK_BOXES;
+    if (need < 1) need = 1;
+    
+    int run = 0;
+    for (int i = 0; i < REGION_POOL_CHUNKS; i++) {
+        if (chunk_used[i]) {
+            run = 0;
+            continue;
+        }
+        if (++run == need) {
+            int first = i - need + 1;
+            for (int j = first; j <= i; j++) {
+                chunk_used[j] = 1;
+            }
+            *capacity = need * REGION_CHUNK_BOXES;
+            pool_used_boxes += *capacity;
+            return first;
+        }
+    }
+    return -1;
+}
+
+static void pool_free(int chunk, int capacity) {
+    if (chunk < 0) return;
+    for (int j = chunk; j < chunk + capacity / REGION_CHUNK_BOXES; j++) {
+        chunk_used[j] = 0;
+    }
+    pool_used_boxes -= capacity;
+}
+
+static void region_release(region_t* r) {
+    pool_free(r->chunk, r->capacity);
+    r->boxes = 0;
+    r->capacity = 0;
+    r->chunk = -1;
+}
+
+static void set_box(region_t* r, int x1, int y1, int x2, int y2) {
+    region_release(r);
+    if (x1 < x2 && y1 < y2) {
+        r->extents.x1 = x1;
+        r->extents.y1 = y1;
+        r->extents.x2 = x2;
+        r->extents.y2 = y2;
+        r->count = 1;
+    } else {
+        r->extents.x1 = r->extents.y1 = r->extents.x2 = r->extents.y2 = 0;
+        r->count = 0;
+    }
+}
+
+static const region_box_t* get_boxes(const region_t* r, int* count) {
+    *count = r->count;
+    return (r->count == 1) ? &r->extents : r->boxes;
+}
+
+void region_init(region_t* r) {
+    r->boxes = 0;
+    r->capacity = 0;
+    r->chunk = -1;
+    r->inexact = 0;
+    set_box(r, 0, 0, 0, 0);
+}
+
+void region_init_rect(region_t* r, int x, int y, int width, int height) {
+    region_init(r);
+    set_box(r, x, y, x + width, y + height);
+}
+
+void region_fini(region_t* r) {
+    region_release(r);
+    r->count = 0;
+}
+
+void region_clear(region_t* r) {
+    set_box(r, 0, 0, 0, 0);
+    r->inexact = 0;
+}
+
+int region_copy(region_t* dst, const region_t* src) {
+    if (dst == src) return 1;
+    
+    if (src->count <= 1) {
+        set_box(dst, src->extents.x1, src->extents.y1, src->extents.x2, src->extents.y2);
+        dst->inexact = src->inexact;
+        return 1;
+    }
+    
+    if (dst->capacity < src->count) {
+        int capacity;
+        int chunk = pool_alloc(src->count, &capacity);
+        if (chunk < 0) {
+            // Out of pool: fall back to the bounding box
+            set_box(dst, src->extents.x1, src->extents.y1, src->extents.x2, src->extents.y2);
+            dst->inexact = 1;
+            return 0;
+        }
+        region_release(dst);
+        dst->chunk = chunk;
+        dst->capacity = capacity;
+        dst->boxes = &region_pool[chunk * REGION_CHUNK_BOXES];
+    }
+    
+    for (int i = 0; i < src->count; i++) {
+        dst->boxes[i] = src->boxes[i];
+    }
+    dst->count = src->count;
+    dst->extents = src->extents;
+    dst->inexact = src->inexact;
+    return 1;
+}
+
+// Output builder used by the set operations. Boxes are appended band by band;
+// a finished band is merged into the previous one when they touch and have
+// identical spans.
+typedef struct {
+    region_box_t* boxes;
+    int count;
+    int capacity;
+    int chunk;
+    int failed;
+    int prev_band;
+    int cur_band;
+} builder_t;
+
+static void builder_init(builder_t* b, int hint) {
+    b->count = 0;
+    b->prev_band = -1;
+    b->cur_band = 0;
+    b->failed = 0;
+    b->chunk = pool_alloc(hint, &b->capacity);
+    if (b->chunk < 0) {
+        b->failed = 1;
+        b->capacity = 0;
+        b->boxes = 0;
+    } else {
+        b->boxes = &region_pool[b->chunk * REGION_CHUNK_BOXES];
+    }
+}
+
+static void builder_push(builder_t* b, int x1, int y1, int x2, int y2) {
+    if (b->failed) return;
+    
+    if (b->count == b->capacity) {
+        // Grow into a run twice the size
+        int capacity;
+        int chunk = pool_alloc(b->capacity * 2, &capacity);
+        if (chunk < 0) {
+            b->failed = 1;
+            return;
+        }
+        region_box_t* boxes = &region_pool[chunk * REGION_CHUNK_BOXES];
+        for (int i = 0; i < b->count; i++) {
+            boxes[i] = b->boxes[i];
+        }
+        pool_free(b->chunk, b->capacity);
+        b->boxes = boxes;
+        b->chunk = chunk;
+        b->capacity = capacity;
+    }
+    
+    region_box_t* box = &b->boxes[b->count++];
+    box->x1 = x1;
+    box->y1 = y1;
+    box->x2 = x2;
+    box->y2 = y2;
+}
+
+static void builder_end_band(builder_t* b) {
+    if (b->failed) return;
+    
+    int n = b->count - b->cur_band;
+    if (n == 0) return;
+    
+    if (b->prev_band >= 0 && b->cur_band - b->prev_band == n) {
+        region_box_t* prev = &b->boxes[b->prev_band];
+        region_box_t* cur = &b->boxes[b->cur_band];
+        int same = (prev[0].y2 == cur[0].y1);
+        for (int i = 0; same && i < n; i++) {
+            if (prev[i].x1 != cur[i].x1 || prev[i].x2 != cur[i].x2) same = 0;
+        }
+        if (same) {
+            for (int i = 0; i < n; i++) {
+                prev[i].y2 = cur[0].y2;
+            }
+            b->count = b->cur_band;
+            b->cur_band = b->count;
+            return;
+        }
+    }
+    
+    b->prev_band = b->cur_band;
+    b->cur_band = b->count;
+}
+
+// Combine the spans of one band from each operand.
+// [as, ae) and [bs, be) index the operands' boxes; empty ranges mean the
+// operand has nothing in this band.
+static void combine_band(builder_t* out, region_op_t op, int y1, int y2,
+                         const region_box_t* a, int as, int ae,
+                         const region_box_t* b, int bs, int be) {
+    int i = as, j = bs;
+    
+    switch (op) {
+        case REGION_OP_UNION: {
+            int have = 0, cx1 = 0, cx2 = 0;
+            while (i < ae || j < be) {
+                const region_box_t* n;
+                if (j >= be || (i < ae && a[i].x1 <= b[j].x1)) {
+                    n = &a[i++];
+                } else {
+                    n = &b[j++];
+                }
+                if (!have) {
+                    cx1 = n->x1;
+                    cx2 = n->x2;
+                    have = 1;
+                } else if (n->x1 <= cx2) {
+                    if (n->x2 > cx2) cx2 = n->x2;
+                } else {
+                    builder_push(out, cx1, y1, cx2, y2);
+                    cx1 = n->x1;
+                    cx2 = n->x2;
+                }
+            }
+            if (have) builder_push(out, cx1, y1, cx2, y2);
+            break;
+        }
+        
+        case REGION_OP_INTERSECT:
+            while (i < ae && j < be) {
+                int x1 = (a[i].x1 > b[j].x1) ? a[i].x1 : b[j].x1;
+                int x2 = (a[i].x2 < b[j].x2) ? a[i].x2 : b[j].x2;
+                if (x1 < x2) builder_push(out, x1, y1, x2, y2);
+                if (a[i].x2 < b[j].x2) {
+                    i++;
+                } else {
+                    j++;
+                }
+            }
+            break;
+        
+        case REGION_OP_SUBTRACT:
+            for (; i < ae; i++) {
+                int x = a[i].x1;
+                while (j < be && b[j].x2 <= x) j++;
+                for (int k = j; k < be && b[k].x1 < a[i].x2; k++) {
+                    if (b[k].x1 > x) builder_push(out, x, y1, b[k].x1, y2);
+                    if (b[k].x2 > x) x = b[k].x2;
+                }
+                if (x < a[i].x2) builder_push(out, x, y1, a[i].x2, y2);
+            }
+            break;
+    }
+    
+    builder_end_band(out);
+}
+
+static int band_end(const region_box_t* boxes, int start, int count) {
+    int e = start;
+    while (e < count && boxes[e].y1 == boxes[start].y1) e++;
+    return e;
+}
+
+// Install a finished builder (or its fallback) into dst
+static int builder_finish(builder_t* out, region_t* dst, const region_box_t* fallback, int inexact) {
+    if (out->failed) {
+        pool_free(out->chunk, out->capacity);
+        set_box(dst, fallback->x1, fallback->y1, fallback->x2, fallback->y2);
+        dst->inexact = 1;
+        return 0;
+    }
+    
+    if (out->count <= 1) {
+        if (out->count == 1) {
+            region_box_t box = out->boxes[0];
+            set_box(dst, box.x1, box.y1, box.x2, box.y2);
+        } else {
+            set_box(dst, 0, 0, 0, 0);
+        }
+        pool_free(out->chunk, out->capacity);
+    } else {
+        // Hand the unused tail of the run back to the pool
+        int keep = (out->count + REGION_CHUNK_BOXES - 1) / REGION_CHUNK_BOXES * REGION_CHUNK_BOXES;
+        if (keep < out->capacity) {
+            pool_free(out->chunk + keep / REGION_CHUNK_BOXES, out->capacity - keep);
+            out->capacity = keep;
+        }
+        
+        region_release(dst);
+        dst->boxes = out->boxes;
+        dst->count = out->count;
+        dst->capacity = out->capacity;
+        dst->chunk = out->chunk;
+        
+        // Bands are sorted, so y comes from the first and last boxes
+        dst->extents.x1 = REGION_INF;
+        dst->extents.x2 = -REGION_INF;
+        dst->extents.y1 = out->boxes[0].y1;
+        dst->extents.y2 = out->boxes[out->count - 1].y2;
+        for (int i = 0; i < out->count; i++) {
+            if (out->boxes[i].x1 < dst->extents.x1) dst->extents.x1 = out->boxes[i].x1;
+            if (out->boxes[i].x2 > dst->extents.x2) dst->extents.x2 = out->boxes[i].x2;
+        }
+    }
+    
+    dst->inexact = inexact;
+    return 1;
+}
+
+// Generic band sweep: walk both operands top to bottom, splitting at every
+// band edge, and combine the x spans that are active in each slice.
+static int region_op(region_t* dst, const region_t* ra, const region_t* rb, region_op_t op) {
+    int na, nb;
+    const region_box_t* a = get_boxes(ra, &na);
+    const region_box_t* b = get_boxes(rb, &nb);
+    int inexact = ra->inexact || rb->inexact;
+    
+    // Bounding box that covers the exact result, used if the pool runs out
+    region_box_t fallback = ra->extents;
+    if (op == REGION_OP_UNION) {
+        if (na == 0) {
+            fallback = rb->extents;
+        } else if (nb > 0) {
+            if (rb->extents.x1 < fallback.x1) fallback.x1 = rb->extents.x1;
+            if (rb->extents.y1 < fallback.y1) fallback.y1 = rb->extents.y1;
+            if (rb->extents.x2 > fallback.x2) fallback.x2 = rb->extents.x2;
+            if (rb->extents.y2 > fallback.y2) fallback.y2 = rb->extents.y2;
+        }
+    } else if (op == REGION_OP_INTERSECT) {
+        if (rb->extents.x1 > fallback.x1) fallback.x1 = rb->extents.x1;
+        if (rb->extents.y1 > fallback.y1) fallback.y1 = rb->extents.y1;
+        if (rb->extents.x2 < fallback.x2) fallback.x2 = rb->extents.x2;
+        if (rb->extents.y2 < fallback.y2) fallback.y2 = rb->extents.y2;
+    }
+    
+    builder_t out;
+    builder_init(&out, (na + nb) * 2);
+    
+    int ia = 0, ib = 0;
+    int ae = (na > 0) ? band_end(a, 0, na) : 0;
+    int be = (nb > 0) ? band_end(b, 0, nb) : 0;
+    int y = -REGION_INF;
+    
+    while (ia < na || ib < nb) {
+        if (op == REGION_OP_INTERSECT && (ia >= na || ib >= nb)) break;
+        if (op == REGION_OP_SUBTRACT && ia >= na) break;
+        
+        int a_top = (ia < na) ? a[ia].y1 : REGION_INF;
+        int a_bot = (ia < na) ? a[ia].y2 : REGION_INF;
+        int b_top = (ib < nb) ? b[ib].y1 : REGION_INF;
+        int b_bot = (ib < nb) ? b[ib].y2 : REGION_INF;
+        
+        // Skip the gap above both current bands
+        if (y < a_top && y < b_top) {
+            y = (a_top < b_top) ? a_top : b_top;
+        }
+        
+        int a_on = (a_top <= y);
+        int b_on = (b_top <= y);
+        int y_next = a_on ? a_bot : a_top;
+        int b_next = b_on ? b_bot : b_top;
+        if (b_next < y_next) y_next = b_next;
+        
+        combine_band(&out, op, y, y_next,
+                     a, ia, a_on ? ae : ia,
+                     b, ib, b_on ? be : ib);
+        y = y_next;
+        
+        if (a_on && y >= a_bot) {
+            ia = ae;
+            ae = band_end(a, ia, na);
+        }
+        if (b_on && y >= b_bot) {
+            ib = be;
+            be = band_end(b, ib, nb);
+        }
+    }
+    
+    return builder_finish(&out, dst, &fallback, inexact);
+}
+
+int region_union(region_t* dst, const region_t* a, const region_t* b) {
+    if (b->count == 0) return region_copy(dst, a);
+    if (a->count == 0) return region_copy(dst, b);
+    return region_op(dst, a, b, REGION_OP_UNION);
+}
+
+int region_intersect(region_t* dst, const region_t* a, const region_t* b) {
+    if (a->count == 0 || b->count == 0 ||
+        a->extents.x2 <= b->extents.x1 || b->extents.x2 <= a->extents.x1 ||
+        a->extents.y2 <= b->extents.y1 || b->extents.y2 <= a->extents.y1) {
+        region_clear(dst);
+        return 1;
+    }
+    if (a->count == 1 && b->count == 1) {
+        int inexact = a->inexact || b->inexact;
+        region_box_t box;
+        box.x1 = (a->extents.x1 > b->extents.x1) ? a->extents.x1 : b->extents.x1;
+        box.y1 = (a->extents.y1 > b->extents.y1) ? a->extents.y1 : b->extents.y1;
+        box.x2 = (a->extents.x2 < b->extents.x2) ? a->extents.x2 : b->extents.x2;
+        box.y2 = (a->extents.y2 < b->extents.y2) ? a->extents.y2 : b->extents.y2;
+        set_box(dst, box.x1, box.y1, box.x2, box.y2);
+        dst->inexact = inexact;
+        return 1;
+    }
+    return region_op(dst, a, b, REGION_OP_INTERSECT);
+}
+
+int region_subtract(region_t* dst, const region_t* a, const region_t* b) {
+    if (a->count == 0 || b->count == 0 ||
+        a->extents.x2 <= b->extents.x1 || b->extents.x2 <= a->extents.x1 ||
+        a->extents.y2 <= b->extents.y1 || b->extents.y2 <= a->extents.y1) {
+        return region_copy(dst, a);
+    }
+    return region_op(dst, a, b, REGION_OP_SUBTRACT);
+}
+
+int region_union_rect(region_t* dst, const region_t* src, int x, int y, int width, int height) {
+    region_t rect;
+    region_init_rect(&rect, x, y, width, height);
+    return region_union(dst, src, &rect);
+}
+
+int region_intersect_rect(region_t* dst, const region_t* src, int x, int y, int width, int height) {
+    region_t rect;
+    region_init_rect(&rect, x, y, width, height);
+    return region_intersect(dst, src, &rect);
+}
+
+int region_subtract_rect(region_t* dst, const region_t* src, int x, int y, int width, int height) {
+    region_t rect;
+    region_init_rect(&rect, x, y, width, height);
+    return region_subtract(dst, src, &rect);
+}
+
+void region_translate(region_t* r, int dx, int dy) {
+    if (r->count == 0) return;
+    
+    r->extents.x1 += dx;
+    r->extents.y1 += dy;
+    r->extents.x2 += dx;
+    r->extents.y2 += dy;
+    if (r->count > 1) {
+        for (int i = 0; i < r->count; i++) {
+            r->boxes[i].x1 += dx;
+            r->boxes[i].y1 += dy;
+            r->boxes[i].x2 += dx;
+            r->boxes[i].y2 += dy;
+        }
+    }
+}
+
+int region_is_empty(const region_t* r) {
+    return r->count == 0;
+}
+
+int region_is_exact(const region_t* r) {
+    return !r->inexact;
+}
+
+int region_contains_point(const region_t* r, int x, int y) {
+    int n;
+    const region_box_t* boxes = get_boxes(r, &n);
+    
+    if (n == 0 || x < r->extents.x1 || x >= r->extents.x2 ||
+        y < r->extents.y1 || y >= r->extents.y2) {
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        if (boxes[i].y1 > y) break;
+        if (y < boxes[i].y2 && x >= boxes[i].x1 && x < boxes[i].x2) return 1;
+    }
+    return 0;
+}
+
+int region_overlaps_rect(const region_t* r, int x, int y, int width, int height) {
+    int n;
+    const region_box_t* boxes = get_boxes(r, &n);
+    int x2 = x + width, y2 = y + height;
+    
+    if (n == 0 || width <= 0 || height <= 0 ||
+        x2 <= r->extents.x1 || x >= r->extents.x2 ||
+        y2 <= r->extents.y1 || y >= r->extents.y2) {
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        if (boxes[i].y1 >= y2) break;
+        if (boxes[i].y2 > y && boxes[i].x1 < x2 && boxes[i].x2 > x) return 1;
+    }
+    return 0;
+}
+
+const region_box_t* region_extents(const region_t* r) {
+    return &r->extents;
+}
+
+const region_box_t* region_boxes(const region_t* r, int* count) {
+    return get_boxes(r, count);
+}
+
+void region_pool_usage(int* used, int* total) {
+    *used = pool_used_boxes;
+    *total = REGION_POOL_BOXES;
+}
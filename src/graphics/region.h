@@ -0,0 +1,69 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include <stdint.h>
+
+// Rectangle regions for damage tracking and occlusion.
+//
+// A region is a list of non-overlapping boxes in banded y-x order: boxes are
+// grouped into horizontal bands that share y1/y2, bands are sorted top to
+// bottom and never overlap, and the boxes of a band are sorted left to right
+// with gaps between them. Vertically adjacent bands with identical spans are
+// coalesced, so every region has a single canonical form.
+//
+// Box storage comes from a fixed pool. When the pool runs out an operation
+// degrades its result to a bounding box that covers the exact answer and
+// flags the region as inexact (region_is_exact() returns 0); callers that
+// need exact coverage, such as occlusion culling, must check it.
+//
+// Regions hold pool memory: initialise with region_init*(), release with
+// region_fini(), and never copy a region_t by value (use region_copy()).
+
+// Half-open box: covers x1 <= x < x2, y1 <= y < y2
+typedef struct {
+    int x1, y1;
+    int x2, y2;
+} region_box_t;
+
+typedef struct {
+    region_box_t extents;   // Bounding box (the only box when count == 1)
+    region_box_t* boxes;    // Pool storage, used when count > 1
+    int count;
+    int capacity;
+    int chunk;              // First pool chunk owned, -1 if none
+    int inexact;            // Set when pool exhaustion forced an approximation
+} region_t;
+
+// Lifetime
+void region_init(region_t* r);
+void region_init_rect(region_t* r, int x, int y, int width, int height);
+void region_fini(region_t* r);
+void region_clear(region_t* r);
+int region_copy(region_t* dst, const region_t* src);
+
+// Set operations; dst may be the same region as either operand.
+// Return 1 on success, 0 if the result had to be approximated.
+int region_union(region_t* dst, const region_t* a, const region_t* b);
+int region_intersect(region_t* dst, const region_t* a, const region_t* b);
+int region_subtract(region_t* dst, const region_t* a, const region_t* b);
+int region_union_rect(region_t* dst, const region_t* src, int x, int y, int width, int height);
+int region_intersect_rect(region_t* dst, const region_t* src, int x, int y, int width, int height);
+int region_subtract_rect(region_t* dst, const region_t* src, int x, int y, int width, int height);
+
+// Move every box by (dx, dy)
+void region_translate(region_t* r, int dx, int dy);
+
+// Queries
+int region_is_empty(const region_t* r);
+int region_is_exact(const region_t* r);
+int region_contains_point(const region_t* r, int x, int y);
+int region_overlaps_rect(const region_t* r, int x, int y, int width, int height);
+const region_box_t* region_extents(const region_t* r);
+
+// Iteration: returns the boxes in banded order and stores their count
+const region_box_t* region_boxes(const region_t* r, int* count);
+
+// Pool usage in boxes
+void region_pool_usage(int* used, int* total);
+
+#endif // REGION_H
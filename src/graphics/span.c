@@ -0,0 +1,760 @@
+#include "span.h"
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+// Freestanding build: keep xmmintrin.h from pulling in the hosted
+// mm_malloc.h/stdlib.h
+#define _MM_MALLOC_H_INCLUDED
+#define __MM_MALLOC_H
+#include <emmintrin.h>
+#include <nmmintrin.h>
+#include <cpuid.h>
+#endif
+
+// x / 255 rounded to nearest; exact for x <= 255 * 255
+static inline uint32_t div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// Single-pixel blends, used by the generic kernels and the SIMD tails.
+// Channels saturate like the SIMD adds if src is not validly premultiplied.
+static inline uint32_t over_pixel(uint32_t s, uint32_t d) {
+    uint32_t ia = 255 - (s >> 24);
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t c = ((s >> shift) & 0xFF) + div255(((d >> shift) & 0xFF) * ia);
+        if (c > 255) c = 255;
+        out |= c << shift;
+    }
+    return out;
+}
+
+static inline uint32_t fade_pixel(uint32_t s, uint32_t d, uint32_t alpha) {
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t c = ((s >> shift) & 0xFF) * alpha + ((d >> shift) & 0xFF) * (255 - alpha);
+        out |= div255(c) << shift;
+    }
+    return out;
+}
+
+// Blur accumulator lanes of one pixel, channels in memory order
+static inline void sum_add_pixel(uint16_t* sum, uint32_t p) {
+    for (int c = 0; c < 4; c++) {
+        sum[c] += (p >> (c * 8)) & 0xFF;
+    }
+}
+
+static inline void sum_sub_pixel(uint16_t* sum, uint32_t p) {
+    for (int c = 0; c < 4; c++) {
+        sum[c] -= (p >> (c * 8)) & 0xFF;
+    }
+}
+
+static inline uint32_t sum_scale_pixel(const uint16_t* sum, uint32_t scale) {
+    uint32_t out = 0;
+    for (int c = 0; c < 4; c++) {
+        out |= ((sum[c] * scale) >> 16) << (c * 8);
+    }
+    return out;
+}
+
+// Span hashing, xxHash32 style: four lanes take every fourth pixel through
+// a multiply-rotate round, then fold into the running hash with the length
+#define HASH_PRIME1 0x9E3779B1u
+#define HASH_PRIME2 0x85EBCA77u
+#define HASH_PRIME3 0xC2B2AE3Du
+
+static inline uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t hash_round(uint32_t acc, uint32_t v) {
+    return rotl32(acc + v * HASH_PRIME2, 13) * HASH_PRIME1;
+}
+
+// Fold the lanes, then the count % 4 tail pixels, into h
+static inline uint32_t hash_finish(uint32_t h, const uint32_t lane[4], const uint32_t* tail, int count) {
+    h ^= rotl32(lane[0], 1) + rotl32(lane[1], 7) + rotl32(lane[2], 12) + rotl32(lane[3], 18);
+    h += (uint32_t)count;
+    for (int i = 0; i < (count & 3); i++) {
+        h = rotl32(h + tail[i] * HASH_PRIME3, 17) * HASH_PRIME1;
+    }
+    return rotl32(h, 15) * HASH_PRIME2;
+}
+
+static inline void hash_lanes_init(uint32_t lane[4], uint32_t h) {
+    lane[0] = h + HASH_PRIME1 + HASH_PRIME2;
+    lane[1] = h + HASH_PRIME2;
+    lane[2] = h;
+    lane[3] = h - HASH_PRIME1;
+}
+
+#if !defined(__aarch64__)
+static uint32_t hash_lanes(const uint32_t* src, int count, uint32_t h) {
+    uint32_t lane[4];
+    hash_lanes_init(lane, h);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lane[0] = hash_round(lane[0], src[i]);
+        lane[1] = hash_round(lane[1], src[i + 1]);
+        lane[2] = hash_round(lane[2], src[i + 2]);
+        lane[3] = hash_round(lane[3], src[i + 3]);
+    }
+    return hash_finish(h, lane, src + i, count);
+}
+#endif
+
+#if defined(__aarch64__)
+
+void span_fill32(uint32_t* dst, uint32_t color, int count) {
+    // Head: single pixels up to a 16-byte boundary
+    while (count > 0 && ((uintptr_t)dst & 15)) {
+        *dst++ = color;
+        count--;
+    }
+    
+    // Body: 64 bytes (16 pixels) per iteration
+    uint32x4_t v = vdupq_n_u32(color);
+    while (count >= 16) {
+        vst1q_u32(dst, v);
+        vst1q_u32(dst + 4, v);
+        vst1q_u32(dst + 8, v);
+        vst1q_u32(dst + 12, v);
+        dst += 16;
+        count -= 16;
+    }
+    while (count >= 4) {
+        vst1q_u32(dst, v);
+        dst += 4;
+        count -= 4;
+    }
+    
+    // Tail
+    while (count > 0) {
+        *dst++ = color;
+        count--;
+    }
+}
+
+void span_expand8(uint32_t* dst, const uint32_t* mask, uint32_t fg, uint32_t bg) {
+    uint32x4_t f = vdupq_n_u32(fg);
+    uint32x4_t b = vdupq_n_u32(bg);
+    vst1q_u32(dst, vbslq_u32(vld1q_u32(mask), f, b));
+    vst1q_u32(dst + 4, vbslq_u32(vld1q_u32(mask + 4), f, b));
+}
+
+void span_expand8_over(uint32_t* dst, const uint32_t* mask, uint32_t fg) {
+    uint32x4_t f = vdupq_n_u32(fg);
+    vst1q_u32(dst, vbslq_u32(vld1q_u32(mask), f, vld1q_u32(dst)));
+    vst1q_u32(dst + 4, vbslq_u32(vld1q_u32(mask + 4), f, vld1q_u32(dst + 4)));
+}
+
+void span_move32(uint32_t* dst, const uint32_t* src, int count) {
+    if (dst <= src || dst >= src + count) {
+        // Forward: each block is loaded before anything overwrites it
+        while (count >= 16) {
+            uint32x4_t a = vld1q_u32(src);
+            uint32x4_t b = vld1q_u32(src + 4);
+            uint32x4_t c = vld1q_u32(src + 8);
+            uint32x4_t d = vld1q_u32(src + 12);
+            vst1q_u32(dst, a);
+            vst1q_u32(dst + 4, b);
+            vst1q_u32(dst + 8, c);
+            vst1q_u32(dst + 12, d);
+            src += 16;
+            dst += 16;
+            count -= 16;
+        }
+        while (count >= 4) {
+            vst1q_u32(dst, vld1q_u32(src));
+            src += 4;
+            dst += 4;
+            count -= 4;
+        }
+        while (count > 0) {
+            *dst++ = *src++;
+            count--;
+        }
+    } else {
+        // dst overlaps the end of src: copy backwards
+        src += count;
+        dst += count;
+        while (count >= 16) {
+            src -= 16;
+            dst -= 16;
+            uint32x4_t a = vld1q_u32(src);
+            uint32x4_t b = vld1q_u32(src + 4);
+            uint32x4_t c = vld1q_u32(src + 8);
+            uint32x4_t d = vld1q_u32(src + 12);
+            vst1q_u32(dst, a);
+            vst1q_u32(dst + 4, b);
+            vst1q_u32(dst + 8, c);
+            vst1q_u32(dst + 12, d);
+            count -= 16;
+        }
+        while (count >= 4) {
+            src -= 4;
+            dst -= 4;
+            vst1q_u32(dst, vld1q_u32(src));
+            count -= 4;
+        }
+        while (count > 0) {
+            *--dst = *--src;
+            count--;
+        }
+    }
+}
+
+// x / 255 per lane, rounded, narrowed to bytes
+static inline uint8x8_t div255_u16(uint16x8_t x) {
+    return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+
+void span_key32(uint32_t* dst, const uint32_t* src, int count, uint32_t key) {
+    uint32x4_t k = vdupq_n_u32(key);
+    while (count >= 8) {
+        uint32x4_t a = vld1q_u32(src);
+        uint32x4_t b = vld1q_u32(src + 4);
+        vst1q_u32(dst, vbslq_u32(vceqq_u32(a, k), vld1q_u32(dst), a));
+        vst1q_u32(dst + 4, vbslq_u32(vceqq_u32(b, k), vld1q_u32(dst + 4), b));
+        src += 8;
+        dst += 8;
+        count -= 8;
+    }
+    while (count > 0) {
+        if (*src != key) *dst = *src;
+        src++;
+        dst++;
+        count--;
+    }
+}
+
+void span_over32(uint32_t* dst, const uint32_t* src, int count) {
+    // 8 pixels per iteration, deinterleaved into B, G, R, A planes
+    while (count >= 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t*)src);
+        if (vminv_u8(s.val[3]) == 255) {
+            vst4_u8((uint8_t*)dst, s);
+        } else {
+            uint8x8x4_t d = vld4_u8((const uint8_t*)dst);
+            uint8x8_t ia = vmvn_u8(s.val[3]);
+            d.val[0] = vqadd_u8(s.val[0], div255_u16(vmull_u8(d.val[0], ia)));
+            d.val[1] = vqadd_u8(s.val[1], div255_u16(vmull_u8(d.val[1], ia)));
+            d.val[2] = vqadd_u8(s.val[2], div255_u16(vmull_u8(d.val[2], ia)));
+            d.val[3] = vqadd_u8(s.val[3], div255_u16(vmull_u8(d.val[3], ia)));
+            vst4_u8((uint8_t*)dst, d);
+        }
+        src += 8;
+        dst += 8;
+        count -= 8;
+    }
+    while (count > 0) {
+        *dst = over_pixel(*src, *dst);
+        src++;
+        dst++;
+        count--;
+    }
+}
+
+void span_fade32(uint32_t* dst, const uint32_t* src, int count, uint32_t alpha) {
+    if (alpha > 255) alpha = 255;
+    uint8x8_t a = vdup_n_u8((uint8_t)alpha);
+    uint8x8_t ia = vdup_n_u8((uint8_t)(255 - alpha));
+    while (count >= 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t*)src);
+        uint8x8x4_t d = vld4_u8((const uint8_t*)dst);
+        d.val[0] = div255_u16(vmlal_u8(vmull_u8(s.val[0], a), d.val[0], ia));
+        d.val[1] = div255_u16(vmlal_u8(vmull_u8(s.val[1], a), d.val[1], ia));
+        d.val[2] = div255_u16(vmlal_u8(vmull_u8(s.val[2], a), d.val[2], ia));
+        d.val[3] = div255_u16(vmlal_u8(vmull_u8(s.val[3], a), d.val[3], ia));
+        vst4_u8((uint8_t*)dst, d);
+        src += 8;
+        dst += 8;
+        count -= 8;
+    }
+    while (count > 0) {
+        *dst = fade_pixel(*src, *dst, alpha);
+        src++;
+        dst++;
+        count--;
+    }
+}
+
+void span_sum_add32(uint16_t* sum, const uint32_t* src, int count) {
+    // Two pixels per widening add
+    while (count >= 4) {
+        uint8x16_t p = vld1q_u8((const uint8_t*)src);
+        vst1q_u16(sum, vaddw_u8(vld1q_u16(sum), vget_low_u8(p)));
+        vst1q_u16(sum + 8, vaddw_u8(vld1q_u16(sum + 8), vget_high_u8(p)));
+        src += 4;
+        sum += 16;
+        count -= 4;
+    }
+    while (count > 0) {
+        sum_add_pixel(sum, *src);
+        src++;
+        sum += 4;
+        count--;
+    }
+}
+
+void span_sum_sub32(uint16_t* sum, const uint32_t* src, int count) {
+    while (count >= 4) {
+        uint8x16_t p = vld1q_u8((const uint8_t*)src);
+        vst1q_u16(sum, vsubw_u8(vld1q_u16(sum), vget_low_u8(p)));
+        vst1q_u16(sum + 8, vsubw_u8(vld1q_u16(sum + 8), vget_high_u8(p)));
+        src += 4;
+        sum += 16;
+        count -= 4;
+    }
+    while (count > 0) {
+        sum_sub_pixel(sum, *src);
+        src++;
+        sum += 4;
+        count--;
+    }
+}
+
+// sum * scale >> 16 for 8 lanes
+static inline uint16x8_t sum_scale_u16(uint16x8_t x, uint16x4_t k) {
+    return vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(x), k), 16),
+                        vshrn_n_u32(vmull_u16(vget_high_u16(x), k), 16));
+}
+
+void span_sum_scale32(uint32_t* dst, const uint16_t* sum, int count, uint32_t scale) {
+    uint16x4_t k = vdup_n_u16((uint16_t)scale);
+    while (count >= 4) {
+        uint8x8_t lo = vmovn_u16(sum_scale_u16(vld1q_u16(sum), k));
+        uint8x8_t hi = vmovn_u16(sum_scale_u16(vld1q_u16(sum + 8), k));
+        vst1q_u8((uint8_t*)dst, vcombine_u8(lo, hi));
+        sum += 16;
+        dst += 4;
+        count -= 4;
+    }
+    while (count > 0) {
+        *dst = sum_scale_pixel(sum, scale);
+        sum += 4;
+        dst++;
+        count--;
+    }
+}
+
+// The scalar lane hash four lanes at a time (same result)
+uint32_t span_hash32(const uint32_t* src, int count, uint32_t h) {
+    uint32_t lane[4];
+    hash_lanes_init(lane, h);
+    uint32x4_t acc = vld1q_u32(lane);
+    uint32x4_t p1 = vdupq_n_u32(HASH_PRIME1);
+    uint32x4_t p2 = vdupq_n_u32(HASH_PRIME2);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        acc = vmlaq_u32(acc, vld1q_u32(src + i), p2);
+        acc = vsriq_n_u32(vshlq_n_u32(acc, 13), acc, 19);
+        acc = vmulq_u32(acc, p1);
+    }
+    vst1q_u32(lane, acc);
+    return hash_finish(h, lane, src + i, count);
+}
+
+#elif defined(__SSE2__)
+
+void span_fill32(uint32_t* dst, uint32_t color, int count) {
+    // Head: single pixels up to a 16-byte boundary
+    while (count > 0 && ((uintptr_t)dst & 15)) {
+        *dst++ = color;
+        count--;
+    }
+    
+    // Body: 64 bytes (16 pixels) per iteration with aligned stores
+    __m128i v = _mm_set1_epi32((int)color);
+    while (count >= 16) {
+        _mm_store_si128((__m128i*)dst, v);
+        _mm_store_si128((__m128i*)(dst + 4), v);
+        _mm_store_si128((__m128i*)(dst + 8), v);
+        _mm_store_si128((__m128i*)(dst + 12), v);
+        dst += 16;
+        count -= 16;
+    }
+    while (count >= 4) {
+        _mm_store_si128((__m128i*)dst, v);
+        dst += 4;
+        count -= 4;
+    }
+    
+    // Tail
+    while (count > 0) {
+        *dst++ = color;
+        count--;
+    }
+}
+
+// (mask & a) | (~mask & b)
+static inline __m128i select128(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void span_expand8(uint32_t* dst, const uint32_t* mask, uint32_t fg, uint32_t bg) {
+    __m128i f = _mm_set1_epi32((int)fg);
+    __m128i b = _mm_set1_epi32((int)bg);
+    _mm_storeu_si128((__m128i*)dst, select128(_mm_load_si128((const __m128i*)mask), f, b));
+    _mm_storeu_si128((__m128i*)(dst + 4), select128(_mm_load_si128((const __m128i*)(mask + 4)), f, b));
+}
+
+void span_expand8_over(uint32_t* dst, const uint32_t* mask, uint32_t fg) {
+    __m128i f = _mm_set1_epi32((int)fg);
+    __m128i lo = _mm_loadu_si128((const __m128i*)dst);
+    __m128i hi = _mm_loadu_si128((const __m128i*)(dst + 4));
+    _mm_storeu_si128((__m128i*)dst, select128(_mm_load_si128((const __m128i*)mask), f, lo));
+    _mm_storeu_si128((__m128i*)(dst + 4), select128(_mm_load_si128((const __m128i*)(mask + 4)), f, hi));
+}
+
+void span_move32(uint32_t* dst, const uint32_t* src, int count) {
+    if (dst <= src || dst >= src + count) {
+        // Forward: each block is loaded before anything overwrites it
+        while (count >= 16) {
+            __m128i a = _mm_loadu_si128((const __m128i*)src);
+            __m128i b = _mm_loadu_si128((const __m128i*)(src + 4));
+            __m128i c = _mm_loadu_si128((const __m128i*)(src + 8));
+            __m128i d = _mm_loadu_si128((const __m128i*)(src + 12));
+            _mm_storeu_si128((__m128i*)dst, a);
+            _mm_storeu_si128((__m128i*)(dst + 4), b);
+            _mm_storeu_si128((__m128i*)(dst + 8), c);
+            _mm_storeu_si128((__m128i*)(dst + 12), d);
+            src += 16;
+            dst += 16;
+            count -= 16;
+        }
+        while (count >= 4) {
+            _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+            src += 4;
+            dst += 4;
+            count -= 4;
+        }
+        while (count > 0) {
+            *dst++ = *src++;
+            count--;
+        }
+    } else {
+        // dst overlaps the end of src: copy backwards
+        src += count;
+        dst += count;
+        while (count >= 16) {
+            src -= 16;
+            dst -= 16;
+            __m128i a = _mm_loadu_si128((const __m128i*)src);
+            __m128i b = _mm_loadu_si128((const __m128i*)(src + 4));
+            __m128i c = _mm_loadu_si128((const __m128i*)(src + 8));
+            __m128i d = _mm_loadu_si128((const __m128i*)(src + 12));
+            _mm_storeu_si128((__m128i*)dst, a);
+            _mm_storeu_si128((__m128i*)(dst + 4), b);
+            _mm_storeu_si128((__m128i*)(dst + 8), c);
+            _mm_storeu_si128((__m128i*)(dst + 12), d);
+            count -= 16;
+        }
+        while (count >= 4) {
+            src -= 4;
+            dst -= 4;
+            _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+            count -= 4;
+        }
+        while (count > 0) {
+            *--dst = *--src;
+            count--;
+        }
+    }
+}
+
+// x / 255 per 16-bit lane, rounded; exact for x <= 255 * 255
+static inline __m128i div255_epu16(__m128i x) {
+    return _mm_mulhi_epu16(_mm_add_epi16(x, _mm_set1_epi16(128)), _mm_set1_epi16(257));
+}
+
+// 255 - alpha of two pixels unpacked to 16-bit lanes, spread over their
+// four channels
+static inline __m128i inv_alpha_epu16(__m128i px) {
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, 0xFF), 0xFF);
+    return _mm_xor_si128(a, _mm_set1_epi16(0xFF));
+}
+
+void span_key32(uint32_t* dst, const uint32_t* src, int count, uint32_t key) {
+    __m128i k = _mm_set1_epi32((int)key);
+    while (count >= 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)src);
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + 4));
+        __m128i da = _mm_loadu_si128((const __m128i*)dst);
+        __m128i db = _mm_loadu_si128((const __m128i*)(dst + 4));
+        _mm_storeu_si128((__m128i*)dst, select128(_mm_cmpeq_epi32(a, k), da, a));
+        _mm_storeu_si128((__m128i*)(dst + 4), select128(_mm_cmpeq_epi32(b, k), db, b));
+        src += 8;
+        dst += 8;
+        count -= 8;
+    }
+    while (count > 0) {
+        if (*src != key) *dst = *src;
+        src++;
+        dst++;
+        count--;
+    }
+}
+
+void span_over32(uint32_t* dst, const uint32_t* src, int count) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i amask = _mm_set1_epi32((int)0xFF000000);
+    
+    // 4 pixels per iteration, two per 16-bit unpacked register
+    while (count >= 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)src);
+        __m128i opaque = _mm_cmpeq_epi32(_mm_and_si128(s, amask), amask);
+        if (_mm_movemask_epi8(opaque) == 0xFFFF) {
+            _mm_storeu_si128((__m128i*)dst, s);
+        } else {
+            __m128i d = _mm_loadu_si128((const __m128i*)dst);
+            __m128i lo = _mm_unpacklo_epi8(d, zero);
+            __m128i hi = _mm_unpackhi_epi8(d, zero);
+            lo = div255_epu16(_mm_mullo_epi16(lo, inv_alpha_epu16(_mm_unpacklo_epi8(s, zero))));
+            hi = div255_epu16(_mm_mullo_epi16(hi, inv_alpha_epu16(_mm_unpackhi_epi8(s, zero))));
+            _mm_storeu_si128((__m128i*)dst, _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+        }
+        src += 4;
+        dst += 4;
+        count -= 4;
+    }
+    while (count > 0) {
+        *dst = over_pixel(*src, *dst);
+        src++;
+        dst++;
+        count--;
+    }
+}
+
+void span_fade32(uint32_t* dst, const uint32_t* src, int count, uint32_t alpha) {
+    if (alpha > 255) alpha = 255;
+    __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_set1_epi16((short)alpha);
+    __m128i ia = _mm_set1_epi16((short)(255 - alpha));
+    while (count >= 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)src);
+        __m128i d = _mm_loadu_si128((const __m128i*)dst);
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), a),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), a),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia));
+        _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(div255_epu16(lo), div255_epu16(hi)));
+        src += 4;
+        dst += 4;
+        count -= 4;
+    }
+    while (count > 0) {
+        *dst = fade_pixel(*src, *dst, alpha);
+        src++;
+        dst++;
+        count--;
+    }
+}
+
+void span_sum_add32(uint16_t* sum, const uint32_t* src, int count) {
+    __m128i zero = _mm_setzero_si128();
+    while (count >= 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)src);
+        __m128i lo = _mm_loadu_si128((const __m128i*)sum);
+        __m128i hi = _mm_loadu_si128((const __m128i*)(sum + 8));
+        _mm_storeu_si128((__m128i*)sum, _mm_add_epi16(lo, _mm_unpacklo_epi8(p, zero)));
+        _mm_storeu_si128((__m128i*)(sum + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(p, zero)));
+        src += 4;
+        sum += 16;
+        count -= 4;
+    }
+    while (count > 0) {
+        sum_add_pixel(sum, *src);
+        src++;
+        sum += 4;
+        count--;
+    }
+}
+
+void span_sum_sub32(uint16_t* sum, const uint32_t* src, int count) {
+    __m128i zero = _mm_setzero_si128();
+    while (count >= 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)src);
+        __m128i lo = _mm_loadu_si128((const __m128i*)sum);
+        __m128i hi = _mm_loadu_si128((const __m128i*)(sum + 8));
+        _mm_storeu_si128((__m128i*)sum, _mm_sub_epi16(lo, _mm_unpacklo_epi8(p, zero)));
+        _mm_storeu_si128((__m128i*)(sum + 8), _mm_sub_epi16(hi, _mm_unpackhi_epi8(p, zero)));
+        src += 4;
+        sum += 16;
+        count -= 4;
+    }
+    while (count > 0) {
+        sum_sub_pixel(sum, *src);
+        src++;
+        sum += 4;
+        count--;
+    }
+}
+
+void span_sum_scale32(uint32_t* dst, const uint16_t* sum, int count, uint32_t scale) {
+    __m128i k = _mm_set1_epi16((short)scale);
+    while (count >= 4) {
+        __m128i lo = _mm_mulhi_epu16(_mm_loadu_si128((const __m128i*)sum), k);
+        __m128i hi = _mm_mulhi_epu16(_mm_loadu_si128((const __m128i*)(sum + 8)), k);
+        _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(lo, hi));
+        sum += 16;
+        dst += 4;
+        count -= 4;
+    }
+    while (count > 0) {
+        *dst = sum_scale_pixel(sum, scale);
+        sum += 4;
+        dst++;
+        count--;
+    }
+}
+
+// With SSE4.2 (checked once with CPUID) the lane round is a CRC32C step,
+// one per pixel; otherwise the scalar lane hash. CRC is linear, so the
+// lanes are only combined by hash_finish, never folded into each other.
+static int hash_has_crc = -1;
+
+__attribute__((target("sse4.2")))
+static uint32_t hash_crc32c(const uint32_t* src, int count, uint32_t h) {
+    uint32_t lane[4];
+    hash_lanes_init(lane, h);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lane[0] = _mm_crc32_u32(lane[0], src[i]);
+        lane[1] = _mm_crc32_u32(lane[1], src[i + 1]);
+        lane[2] = _mm_crc32_u32(lane[2], src[i + 2]);
+        lane[3] = _mm_crc32_u32(lane[3], src[i + 3]);
+    }
+    return hash_finish(h, lane, src + i, count);
+}
+
+uint32_t span_hash32(const uint32_t* src, int count, uint32_t h) {
+    if (hash_has_crc < 0) {
+        unsigned int eax, ebx, ecx = 0, edx;
+        hash_has_crc = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2);
+    }
+    if (hash_has_crc) return hash_crc32c(src, count, h);
+    return hash_lanes(src, count, h);
+}
+
+#else
+
+void span_fill32(uint32_t* dst, uint32_t color, int count) {
+    // Generic fallback: 8 pixels per iteration
+    while (count >= 8) {
+        dst[0] = color;
+        dst[1] = color;
+        dst[2] = color;
+        dst[3] = color;
+        dst[4] = color;
+        dst[5] = color;
+        dst[6] = color;
+        dst[7] = color;
+        dst += 8;
+        count -= 8;
+    }
+    while (count > 0) {
+        *dst++ = color;
+        count--;
+    }
+}
+
+void span_expand8(uint32_t* dst, const uint32_t* mask, uint32_t fg, uint32_t bg) {
+    for (int i = 0; i < 8; i++) {
+        dst[i] = (fg & mask[i]) | (bg & ~mask[i]);
+    }
+}
+
+void span_expand8_over(uint32_t* dst, const uint32_t* mask, uint32_t fg) {
+    for (int i = 0; i < 8; i++) {
+        dst[i] = (fg & mask[i]) | (dst[i] & ~mask[i]);
+    }
+}
+
+void span_move32(uint32_t* dst, const uint32_t* src, int count) {
+    if (dst <= src || dst >= src + count) {
+        // Forward: each pixel is read before anything overwrites it
+        for (int i = 0; i < count; i++) {
+            dst[i] = src[i];
+        }
+    } else {
+        // dst overlaps the end of src: copy backwards
+        for (int i = count - 1; i >= 0; i--) {
+            dst[i] = src[i];
+        }
+    }
+}
+
+void span_key32(uint32_t* dst, const uint32_t* src, int count, uint32_t key) {
+    for (int i = 0; i < count; i++) {
+        if (src[i] != key) dst[i] = src[i];
+    }
+}
+
+void span_over32(uint32_t* dst, const uint32_t* src, int count) {
+    for (int i = 0; i < count; i++) {
+        if ((src[i] >> 24) == 255) {
+            dst[i] = src[i];
+        } else {
+            dst[i] = over_pixel(src[i], dst[i]);
+        }
+    }
+}
+
+void span_fade32(uint32_t* dst, const uint32_t* src, int count, uint32_t alpha) {
+    if (alpha > 255) alpha = 255;
+    for (int i = 0; i < count; i++) {
+        dst[i] = fade_pixel(src[i], dst[i], alpha);
+    }
+}
+
+void span_sum_add32(uint16_t* sum, const uint32_t* src, int count) {
+    for (int i = 0; i < count; i++) {
+        sum_add_pixel(sum + i * 4, src[i]);
+    }
+}
+
+void span_sum_sub32(uint16_t* sum, const uint32_t* src, int count) {
+    for (int i = 0; i < count; i++) {
+        sum_sub_pixel(sum + i * 4, src[i]);
+    }
+}
+
+void span_sum_scale32(uint32_t* dst, const uint16_t* sum, int count, uint32_t scale) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = sum_scale_pixel(sum + i * 4, scale);
+    }
+}
+
+uint32_t span_hash32(const uint32_t* src, int count, uint32_t h) {
+    return hash_lanes(src, count, h);
+}
+
+#endif
+
+// Scanout converters, one loop per format stamped out from its packing
+// expression so the inner loop carries no format test
+#define SPAN_CONVERTER(name, type, pack)                        \
+    void name(void* dst, const uint32_t* src, int count) {      \
+        type* out = (type*)dst;                                 \
+        for (int i = 0; i < count; i++) {                       \
+            uint32_t p = src[i];                                \
+            out[i] = (type)(pack);                              \
+        }                                                       \
+    }
+
+// Swap red and blue
+SPAN_CONVERTER(span_to_xbgr8888, uint32_t,
+               (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16))
+
+// Top 5/6/5 bits of red/green/blue
+SPAN_CONVERTER(span_to_rgb565, uint16_t,
+               ((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F))
+
+// 3-3-2 palette index: top 3 bits of red and green, top 2 of blue
+SPAN_CONVERTER(span_to_pal8, uint8_t,
+               ((p >> 16) & 0xE0) | ((p >> 11) & 0x1C) | ((p >> 6) & 0x03))
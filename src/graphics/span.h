@@ -0,0 +1,56 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <stdint.h>
+
+// Pixel span kernels shared by the gfx primitives. The implementation is
+// picked at build time: NEON on AArch64, SSE2 on x86 when the compiler
+// targets it, plain C otherwise.
+
+// Fill count 32-bit pixels starting at dst with color
+void span_fill32(uint32_t* dst, uint32_t color, int count);
+
+// Copy count pixels from src to dst; the spans may overlap (memmove)
+void span_move32(uint32_t* dst, const uint32_t* src, int count);
+
+// Write 8 pixels selecting fg where mask is all-ones and bg where it is zero.
+// mask points at 8 words of 0x00000000/0xFFFFFFFF, 16-byte aligned.
+void span_expand8(uint32_t* dst, const uint32_t* mask, uint32_t fg, uint32_t bg);
+
+// As span_expand8, but pixels outside the mask keep their current value
+void span_expand8_over(uint32_t* dst, const uint32_t* mask, uint32_t fg);
+
+// Blit kernels over count pixels of 32-bit ARGB. src and dst must not
+// overlap (use span_move32 for overlapping copies).
+
+// Copy src pixels that differ from key; pixels equal to key leave dst as is
+void span_key32(uint32_t* dst, const uint32_t* src, int count, uint32_t key);
+
+// Premultiplied-alpha "over": dst = src + dst * (255 - src.a) / 255
+void span_over32(uint32_t* dst, const uint32_t* src, int count);
+
+// Constant-alpha fade: dst = (src * alpha + dst * (255 - alpha)) / 255
+void span_fade32(uint32_t* dst, const uint32_t* src, int count, uint32_t alpha);
+
+// Box blur accumulators: per-channel sums in 16-bit lanes, four per pixel
+// in the pixels' byte order, so one lane holds the sum of up to 257 pixels.
+// Add or remove count pixels of src from sum
+void span_sum_add32(uint16_t* sum, const uint32_t* src, int count);
+void span_sum_sub32(uint16_t* sum, const uint32_t* src, int count);
+
+// Average out of the sums of n pixels: each channel is sum * scale >> 16,
+// with scale = (65536 + n - 1) / n for 2 <= n <= 257
+void span_sum_scale32(uint32_t* dst, const uint16_t* sum, int count, uint32_t scale);
+
+// Hash count pixels into h, for change detection. An xxHash32-style lane
+// hash, with CRC32C rounds on x86 CPUs that have SSE4.2; results are only
+// comparable on the same machine.
+uint32_t span_hash32(const uint32_t* src, int count, uint32_t h);
+
+// Scanout conversion from the 32-bit XRGB render format: count pixels of
+// src are packed into dst in the named framebuffer format
+void span_to_xbgr8888(void* dst, const uint32_t* src, int count);
+void span_to_rgb565(void* dst, const uint32_t* src, int count);
+void span_to_pal8(void* dst, const uint32_t* src, int count);
+
+#endif // SPAN_H
@@ -15,6 +15,9 @@ void gui_init(int width, int height, void* fb, int pitch) {
     // Initialize graphics with framebuffer
     gfx_init(width, height, fb, pitch);
     
+    // gfx_init may clamp the drawn area to the back buffer
+    gfx_get_size(&width, &height);
+    
     // Initialize state
     gui.initialized = 1;
     gui.width = width;
@@ -49,20 +52,26 @@ void gui_init(int width, int height, void* fb, int pitch) {
     gui.taskbar_height = TASKBAR_HEIGHT;
     gui.clock_x = width - 80;
     gui.start_text = "Start";
+    gui.taskbar_panel = 0;
     
     // Event queue
     gui.event_head = 0;
     gui.event_tail = 0;
+    gui.event_peak = 0;
     
     // Loop control
     gui.running = 1;
     gui.needs_redraw = 1;
+    gui.wake_pending = 0;
     
     // Initialize window system
     window_system_init();
     
     // Clear screen with background
     clear_screen(GUI_COLOR_DESKTOP);
+    
+    // The pointer is a layer of its own, put over every present
+    draw_mouse_cursor(gui.mouse.x, gui.mouse.y);
 }
 
 // Shutdown GUI
@@ -73,11 +82,15 @@ void gui_shutdown() {
 
 // Queue an event
 void gui_queue_event(event_t* event) {
-    int next = (gui.event_tail + 1) % 64;
+    int next = (gui.event_tail + 1) % GUI_EVENT_QUEUE_SIZE;
     if (next != gui.event_head) {
         gui.event_queue[gui.event_tail] = *event;
         gui.event_tail = next;
+        
+        int depth = (next - gui.event_head + GUI_EVENT_QUEUE_SIZE) % GUI_EVENT_QUEUE_SIZE;
+        if (depth > gui.event_peak) gui.event_peak = depth;
     }
+    gui_wake();
 }
 
 // Poll for event (non-blocking)
@@ -86,7 +99,7 @@ int gui_poll_event(event_t* event) {
         return 0;
     }
     *event = gui.event_queue[gui.event_head];
-    gui.event_head = (gui.event_head + 1) % 64;
+    gui.event_head = (gui.event_head + 1) % GUI_EVENT_QUEUE_SIZE;
     return 1;
 }
 
@@ -99,6 +112,7 @@ void gui_handle_event(event_t* event) {
             // Update mouse position
             gui.mouse.x = event->mouse_x;
             gui.mouse.y = event->mouse_y;
+            windows_update_hover(event->mouse_x, event->mouse_y);
             // Find window under cursor and route event
             window_t* win = window_at(event->mouse_x, event->mouse_y);
             if (win) {
@@ -140,6 +154,11 @@ void gui_handle_event(event_t* event) {
             if (event->key_code == 0x01) {  // ESC key
                 gui.running = 0;
             }
+            
+            // F12 shows or hides the performance overlay
+            if (event->key_code == 0x58) {
+                hud_toggle();
+            }
             break;
         }
         case EVENT_KEY_UP: {
@@ -149,7 +168,7 @@ void gui_handle_event(event_t* event) {
         case EVENT_REDRAW:
             gui.needs_redraw = 1;
             break;
-            
+        
         default:
             break;
     }
@@ -160,30 +179,47 @@ void gui_get_time_string(char* buffer, size_t size) {
     snprintf(buffer, size, "12:00");
 }
 
-// Redraw entire GUI
-void gui_redraw_all() {
-    if (!gui.framebuffer) return;
-    
-    // Draw desktop background - gradient effect
-    for (int y = 0; y < gui.height - gui.taskbar_height; y++) {
-        // Create a subtle gradient from top to bottom
-        uint8_t r = 0x0d + (y * 3 / 100);
-        uint8_t g = 0x3d + (y * 3 / 100);
-        uint8_t b = 0x52 + (y * 2 / 100);
-        uint32_t color = 0xFF000000 | (r << 16) | (g << 8) | b;
-        
-        uint32_t* row = (uint32_t*)((uint8_t*)gui.framebuffer + y * gui.pitch);
-        for (int x = 0; x < gui.width; x++) {
-            row[x] = color;
+// Desktop gradient colour of a screen row (a subtle top-to-bottom gradient)
+static uint32_t desktop_row_color(int row) {
+    uint8_t r = 0x0d + (row * 3 / 100);
+    uint8_t g = 0x3d + (row * 3 / 100);
+    uint8_t b = 0x52 + (row * 2 / 100);
+    return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+// The gradient as a table of row colours, built once per screen height
+static uint32_t* g_desktop_rows = 0;
+static int g_desktop_rows_height = 0;
+
+static const uint32_t* desktop_rows(void) {
+    if (g_desktop_rows_height != gui.height) {
+        free(g_desktop_rows);
+        g_desktop_rows = (uint32_t*)malloc(gui.height * sizeof(uint32_t));
+        g_desktop_rows_height = g_desktop_rows ? gui.height : 0;
+        for (int row = 0; row < g_desktop_rows_height; row++) {
+            g_desktop_rows[row] = desktop_row_color(row);
         }
     }
+    return g_desktop_rows;
+}
+
+// Paint one rectangle of the desktop background: a fill per row from the
+// gradient table
+static void draw_desktop_background(int x, int y, int width, int height) {
+    const uint32_t* rows = desktop_rows();
+    if (rows) {
+        fill_rect_rows(x, y, width, height, rows + y);
+        return;
+    }
     
-    // Draw windows
-    windows_draw_all();
-    
-    // Draw taskbar
-    int y = gui.height - gui.taskbar_height;
-    fill_rect(0, y, gui.width, gui.taskbar_height, GUI_COLOR_TASKBAR);
+    // No memory for the table
+    for (int row = y; row < y + height; row++) {
+        fill_rect(x, row, width, 1, desktop_row_color(row));
+    }
+}
+
+// Taskbar contents over its background: top edge, start button and clock
+static void draw_taskbar_items(int y) {
     draw_line(0, y, gui.width, y, GUI_COLOR_LIGHT_GRAY);
     
     // Draw start button with gradient
@@ -194,11 +230,178 @@ void gui_redraw_all() {
     // Draw clock area
     char time_str[16];
     gui_get_time_string(time_str, sizeof(time_str));
-    draw_string(gui.width - 70, y + 10, time_str, GUI_COLOR_WHITE, GUI_COLOR_TASKBAR);
+    draw_string_transparent(gui.width - 70, y + 10, time_str, GUI_COLOR_WHITE);
+}
+
+static void taskbar_panel_draw(panel_t* panel) {
+    draw_taskbar_items(panel->y);
+}
+
+// Compose the screen through the active clip: desktop background, then the
+// windows' retained surfaces, then the taskbar and any frosted panels
+static void gui_paint_scene(void) {
+    gfx_rect_t clip;
+    gfx_get_clip(&clip);
+    
+    // Draw desktop background only where no window covers it
+    int box_count;
+    const region_box_t* boxes = region_boxes(windows_desktop_region(), &box_count);
+    for (int i = 0; i < box_count; i++) {
+        int x1 = boxes[i].x1 > clip.x ? boxes[i].x1 : clip.x;
+        int y1 = boxes[i].y1 > clip.y ? boxes[i].y1 : clip.y;
+        int x2 = boxes[i].x2 < clip.x + clip.width ? boxes[i].x2 : clip.x + clip.width;
+        int y2 = boxes[i].y2 < clip.y + clip.height ? boxes[i].y2 : clip.y + clip.height;
+        if (x1 < x2 && y1 < y2) {
+            draw_desktop_background(x1, y1, x2 - x1, y2 - y1);
+        }
+    }
+    
+    // Draw the visible parts of the windows
+    windows_draw_all();
+    
+    // Draw taskbar (a frosted one is a panel)
+    int y = gui.height - gui.taskbar_height;
+    if (!gui.taskbar_panel && clip.y + clip.height > y) {
+        fill_rect(0, y, gui.width, gui.taskbar_height, GUI_COLOR_TASKBAR);
+        draw_taskbar_items(y);
+    }
+    
+    // Frosted panels blur everything drawn before them
+    panels_paint();
+}
+
+// Redraw entire GUI
+void gui_redraw_all() {
+    if (!gui.framebuffer) return;
+    
+    // Work out, front to back, what each window and the desktop still show
+    windows_update_visibility();
+    
+    gui_paint_scene();
     
     gui.needs_redraw = 0;
 }
 
+// Repaint the frosted panels that partial repaints cut since the last
+// frame, each as a whole. However many repaints cut a panel, it is blurred once.
+static void gui_paint_panels(void) {
+    gfx_rect_t rect;
+    while (panels_dirty_rect(&rect)) {
+        gfx_push_clip(rect.x, rect.y, rect.width, rect.height);
+        gui_paint_scene();
+        gfx_pop_clip();
+    }
+}
+
+// Frame pacing state
+static gui_clock_fn frame_clock = 0;
+static uint32_t frame_period = 1000000 / GUI_FRAME_RATE;
+static uint32_t frame_next = 0;
+static gui_frame_stats_t frame_stats;
+
+void gui_set_clock(gui_clock_fn clock) {
+    frame_clock = clock;
+    frame_next = clock ? clock() : 0;
+}
+
+void gui_set_frame_rate(int hz) {
+    if (hz <= 0) hz = GUI_FRAME_RATE;
+    frame_period = 1000000 / hz;
+}
+
+void gui_frame_stats(gui_frame_stats_t* stats) {
+    if (stats) *stats = frame_stats;
+}
+
+// Render and present one frame if one is due. Invalidations between frames
+// are coalesced: they only set needs_redraw or add damage, and are drawn
+// together at the next frame boundary. Returns 1 if a frame was rendered.
+int gui_frame(void) {
+    if (!frame_clock) {
+        if (gui.needs_redraw && gui.framebuffer) {
+            gui_redraw_all();
+        }
+        gui_paint_panels();
+        hud_draw(0);
+        gfx_present();
+        hud_frame_done(0);
+        return 1;
+    }
+    
+    uint32_t now = frame_clock();
+    if ((int32_t)(now - frame_next) < 0) return 0;
+    
+    // Came in more than a slot late: the next one is a period from now
+    uint32_t deadline = frame_next;
+    frame_next += frame_period;
+    if ((int32_t)(now - frame_next) >= 0) frame_next = now + frame_period;
+    
+    // Nothing to show: let the slot pass without touching the screen
+    if (!gui.needs_redraw && !gfx_damage_pending() && !hud_due(now)) {
+        frame_stats.idle++;
+        return 0;
+    }
+    
+    if (gui.needs_redraw && gui.framebuffer) {
+        gui_redraw_all();
+    }
+    gui_paint_panels();
+    
+    // The overlay goes over everything else drawn this frame
+    hud_draw(now);
+    gfx_present();
+    
+    uint32_t end = frame_clock();
+    frame_stats.frames++;
+    frame_stats.last_us = end - now;
+    if (frame_stats.last_us > frame_stats.worst_us) {
+        frame_stats.worst_us = frame_stats.last_us;
+    }
+    if (end - deadline > frame_period) {
+        frame_stats.missed++;
+    }
+    hud_frame_done(frame_stats.last_us);
+    panels_frame_done(frame_stats.last_us, frame_period);
+    
+    // Overran the next slot as well: start counting again from now
+    if ((int32_t)(end - frame_next) >= 0) frame_next = end;
+    return 1;
+}
+
+// Idle state
+static gui_idle_fn idle_wait = 0;
+
+void gui_set_idle(gui_idle_fn idle) {
+    idle_wait = idle;
+}
+
+void gui_wake(void) {
+    gui.wake_pending = 1;
+}
+
+// Sleep until the next interrupt if this pass left nothing to do. Damage
+// waiting for its frame slot does not keep the loop awake: the timer tick
+// that ends the sleep comes well inside a frame period.
+void gui_idle(void) {
+    if (idle_wait && !gui.wake_pending && gui.event_head == gui.event_tail) {
+        idle_wait();
+    }
+    gui.wake_pending = 0;
+}
+
+// Repaint a single screen rectangle, e.g. an area exposed by a window move
+void gui_redraw_rect(int x, int y, int width, int height) {
+    if (!gui.framebuffer) return;
+    
+    gfx_push_clip(x, y, width, height);
+    gui_paint_scene();
+    gfx_pop_clip();
+    
+    // Frosted panels the rectangle cuts were skipped: their blur reaches
+    // across its edge, so they are repainted whole, once, before present
+    panels_invalidate(x, y, width, height);
+}
+
 void widget_draw(widget_t* widget) {
     if (!widget) return;
     if (widget->draw) {
@@ -244,6 +447,14 @@ void gui_create_desktop() {
     about->flags = WINDOW_FLAG_HAS_CLOSE;
     about->bg_color = GUI_COLOR_WINDOW_BG;
     
+    // Frosted taskbar; stays opaque if there is no memory for the panel
+    gui.taskbar_panel = panel_create(0, gui.height - gui.taskbar_height,
+                                     gui.width, gui.taskbar_height,
+                                     GUI_COLOR_TASKBAR, TASKBAR_TINT_ALPHA);
+    if (gui.taskbar_panel) {
+        gui.taskbar_panel->draw = taskbar_panel_draw;
+    }
+    
     // Request initial redraw
     gui.needs_redraw = 1;
 }
@@ -287,24 +498,19 @@ static uint8_t g_mouse_packet[3] = {0};
 // Main GUI loop (x86 version)
 void gui_run() {
     if (!gui.initialized) return;
-
+    
     event_t event;
-
+    
     g_mouse_packet_byte = 0;
     last_mouse_buttons = gui.mouse.buttons;
-
+    
     // Clear keyboard buffer
     for (int i = 0; i < 256; i++) {
         port_inb(KEYBOARD_DATA_PORT);
     }
-
+    
     // Main event loop
     while (gui.running) {
-        // Simple delay
-        for (int i = 0; i < 50000; i++) {
-            __asm__("nop");
-        }
-        
         // Poll for keyboard input
         int key_count = 0;
         while (key_count < 4) {
@@ -342,6 +548,9 @@ void gui_run() {
                     if (gui.mouse.y < 0) gui.mouse.y = 0;
                     if (gui.mouse.y >= gui.height) gui.mouse.y = gui.height - 1;
                     
+                    // Move the pointer layer now; windows see the event below
+                    draw_mouse_cursor(gui.mouse.x, gui.mouse.y);
+                    
                     event.type = EVENT_MOUSE_MOVE;
                     event.mouse_x = gui.mouse.x;
                     event.mouse_y = gui.mouse.y;
@@ -378,10 +587,14 @@ void gui_run() {
             gui_handle_event(&event);
         }
         
-        // Redraw if needed
-        if (gui.needs_redraw && gui.framebuffer) {
-            gui_redraw_all();
+        // Draw and present everything invalidated so far, once per frame
+        gui_frame();
+        
+        // Bytes still waiting in the controller raise no new interrupt
+        if (port_inb(KEYBOARD_STATUS_PORT) & 0x01) {
+            gui_wake();
         }
+        gui_idle();
     }
 }
 #endif // !__aarch64__
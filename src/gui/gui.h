@@ -3,13 +3,17 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "../graphics/region.h"
+#include "../graphics/gfx.h"
 
 // GUI Common definitions
 #define WINDOW_TITLE_HEIGHT 24
 #define TASKBAR_HEIGHT 32
+#define TASKBAR_TINT_ALPHA 176
 #define BUTTON_HEIGHT 24
 #define BORDER_SIZE 1
 #define RESIZE_HANDLE 8
+#define GUI_EVENT_QUEUE_SIZE 64
 
 // GUI Colors (ARGB format)
 #define GUI_COLOR_BLACK      0xFF000000
@@ -24,6 +28,7 @@
 #define GUI_COLOR_YELLOW     0xFFFFFF00
 #define GUI_COLOR_MAGENTA    0xFFFF00FF
 #define GUI_COLOR_TITLE_BAR  0xFF2a5f7f
+#define GUI_COLOR_TITLE_BAR_INACTIVE 0xFF56707f
 #define GUI_COLOR_TASKBAR    0xFF1a4d6d
 #define GUI_COLOR_DESKTOP    0xFF0d3d52
 #define GUI_COLOR_WINDOW_BG  0xFFE0E0E0
@@ -141,8 +146,23 @@ typedef struct window {
     void (*on_click)(struct window*, int, int);
     widget_t* content;
     struct window* parent;
+    gfx_surface_t surface;      // Retained rendering (no pixels: draw directly)
+    int surface_valid;          // Surface matches the window's current state
 } window_t;
 
+// Window chrome colours. The title bar and button sprites are rendered
+// from these once and reused until the theme changes.
+typedef struct {
+    uint32_t title_active;
+    uint32_t title_inactive;
+    uint32_t title_text;
+    uint32_t button;
+    uint32_t button_hover;
+    uint32_t button_border;
+    uint32_t button_glyph;
+    uint32_t close_mark;
+} window_theme_t;
+
 // Button widget structure
 typedef struct button {
     widget_t base;
@@ -153,6 +173,27 @@ typedef struct button {
     void (*on_click)(struct button*);
 } button_t;
 
+// Frosted panel: a translucent rectangle over the rest of the scene that
+// shows a blurred, tinted copy of what is behind it
+typedef struct panel {
+    struct panel* next;
+    int x, y;
+    int width, height;
+    uint32_t tint;              // Colour laid over the blurred backdrop
+    uint32_t tint_alpha;        // 0 = clear glass, 255 = solid tint
+    void (*draw)(struct panel*);    // Foreground, in screen coordinates
+    void* data;
+    gfx_surface_t surface;      // The frosted backdrop at full size
+    uint32_t* small;            // Shrunk backdrop being blurred
+    uint32_t* scratch;
+    uint32_t* wide;             // Blurred rows stretched to full width
+    uint32_t* pad;
+    uint16_t* sums;
+    uint32_t backdrop_hash;     // Shrunk backdrop the surface was made from
+    int cache_level;            // Blur level it was made at (-1: none)
+    int dirty;                  // Cut by a repaint; to be repainted whole
+} panel_t;
+
 // GUI system state
 typedef struct {
     int initialized;
@@ -176,15 +217,18 @@ typedef struct {
     int taskbar_height;
     int clock_x;
     const char* start_text;
+    panel_t* taskbar_panel;     // Frosted taskbar (0: painted opaque)
     
     // Event queue
-    event_t event_queue[64];
+    event_t event_queue[GUI_EVENT_QUEUE_SIZE];
     int event_head;
     int event_tail;
+    int event_peak;             // Deepest the queue has been (reset by the HUD)
     
     // GUI loop control
     int running;
     int needs_redraw;
+    volatile int wake_pending;  // Work arrived: don't sleep after this pass
 } gui_system_t;
 
 // Global GUI system
@@ -208,6 +252,7 @@ void mouse_get_position(int* x, int* y);
 void mouse_set_position(int x, int y);
 void enable_mouse();
 void mouse_interrupt_handler();
+void ps2_enable_irqs();
 
 // Keyboard input
 void keyboard_init();
@@ -230,7 +275,12 @@ void window_restore(window_t* win);
 void window_toggle_maximize(window_t* win);
 void window_close(window_t* win);
 void window_draw(window_t* win);
+void window_invalidate(window_t* win);
+void window_set_theme(const window_theme_t* theme);
+void windows_update_hover(int x, int y);
 void windows_draw_all();
+void windows_update_visibility();
+const region_t* windows_desktop_region();
 void window_system_init();
 void window_handle_event(window_t* win, event_t* event);
 window_t* window_at(int x, int y);
@@ -251,11 +301,77 @@ extern void draw_rect(int x, int y, int width, int height, uint32_t color);
 extern void draw_line(int x1, int y1, int x2, int y2, uint32_t color);
 extern void draw_char(int x, int y, char c, uint32_t fg, uint32_t bg);
 extern void draw_string(int x, int y, const char* str, uint32_t fg, uint32_t bg);
+extern void draw_char_transparent(int x, int y, char c, uint32_t fg);
+extern void draw_string_transparent(int x, int y, const char* str, uint32_t fg);
 extern void clear_screen(uint32_t color);
+extern void gfx_push_clip(int x, int y, int width, int height);
+extern void gfx_pop_clip(void);
+extern void gfx_copy_rect(int src_x, int src_y, int width, int height, int dst_x, int dst_y);
 
 // Main GUI loop
 void gui_run();
 void gui_redraw_all();
+void gui_redraw_rect(int x, int y, int width, int height);
+
+// Frame pacing. gui_run() calls gui_frame() after handling input; with a
+// clock set it renders at most once per frame period, and only if something
+// was invalidated since the last frame. Without a clock it renders every call.
+#define GUI_FRAME_RATE 60
+
+typedef uint32_t (*gui_clock_fn)(void);     // microseconds, may wrap
+
+typedef struct {
+    uint32_t frames;        // frames rendered
+    uint32_t idle;          // frame slots skipped because nothing changed
+    uint32_t missed;        // frames that finished more than a period late
+    uint32_t last_us;       // render + present time of the last frame
+    uint32_t worst_us;
+} gui_frame_stats_t;
+
+void gui_set_clock(gui_clock_fn clock);
+void gui_set_frame_rate(int hz);
+int gui_frame(void);
+void gui_frame_stats(gui_frame_stats_t* stats);
+
+// Idle. At the end of each pass gui_run() calls gui_idle(), which sleeps
+// in the function set here unless input was seen or an event was queued
+// during the pass (gui_wake()). idle() must return once an interrupt or
+// timer tick has arrived, and must not miss one raised before it sleeps.
+typedef void (*gui_idle_fn)(void);
+
+void gui_set_idle(gui_idle_fn idle);
+void gui_wake(void);
+void gui_idle(void);
+
+// Performance overlay, toggled with F12: frame time (min/avg/p99 over the
+// last HUD_SAMPLES frames), fps, pixels filled and blitted per frame, event
+// queue depth, heap use and interrupt rates. gui_frame() feeds it frame
+// times and draws it last, over everything else in the frame.
+#define HUD_SAMPLES 128
+
+typedef uint32_t (*hud_irq_fn)(int irq);   // interrupts taken on a line (0-15)
+
+void hud_toggle(void);
+int hud_visible(void);
+int hud_overlaps(int x, int y, int width, int height);
+void hud_set_irq_source(hud_irq_fn count);
+void hud_frame_done(uint32_t frame_us);
+int hud_due(uint32_t now);
+void hud_draw(uint32_t now);
+
+// Frosted panels, painted last by every repaint that covers all of one.
+// The backdrop is shrunk, box blurred and tinted, and the result kept
+// until the shrunk backdrop changes. A frame that re-blurs a panel and
+// overruns its budget drops the blur to a coarser level; sustained fast
+// frames bring it back.
+panel_t* panel_create(int x, int y, int width, int height, uint32_t tint, uint32_t tint_alpha);
+void panel_destroy(panel_t* panel);
+void panels_paint(void);
+int panels_overlap(int x, int y, int width, int height);
+void panels_invalidate(int x, int y, int width, int height);
+int panels_dirty_rect(gfx_rect_t* rect);
+void panels_frame_done(uint32_t frame_us, uint32_t budget_us);
+int panels_blur_level(void);
 
 // Time functions
 void gui_update_clock();
@@ -0,0 +1,278 @@
+#include "gui.h"
+#include "../libc_compat.h"
+
+// Performance overlay. The labels are rendered once into a plate and the
+// digits 0-9 into a strip; drawing the overlay is one blit of the plate and
+// one 8x8 blit per digit shown. Values are recomputed every HUD_REFRESH_US
+// or HUD_REFRESH_FRAMES frames, whichever comes first; in between the
+// overlay is only redrawn where something painted over it.
+#define HUD_REFRESH_US      500000
+#define HUD_REFRESH_FRAMES  32
+#define HUD_MARGIN          8
+#define HUD_PADDING         4
+#define HUD_LINE_HEIGHT     10
+#define HUD_MAX_FIELDS      24
+#define HUD_MAX_IRQS        3
+
+#define HUD_COLOR_BG        0xFF101820
+#define HUD_COLOR_LABEL     0xFF90A0A8
+#define HUD_COLOR_VALUE     0xFF7CFFB0
+
+// Each '#' run is a right-aligned number field; fields are numbered in
+// reading order (see the HUD_F_* indices)
+static const char* const hud_template[] = {
+    "min ######  avg ######  p99 ######",
+    "fps ####    frames ##########",
+    "px/frame fill ######## blit ########",
+    "queue ##/##   heap ######/###### KB",
+    "irq/s ##:######  ##:######  ##:######",
+};
+#define HUD_LINES ((int)(sizeof(hud_template) / sizeof(hud_template[0])))
+#define HUD_COLUMNS 37
+#define HUD_WIDTH (HUD_COLUMNS * 8 + 2 * HUD_PADDING)
+#define HUD_HEIGHT (HUD_LINES * HUD_LINE_HEIGHT - 2 + 2 * HUD_PADDING)
+
+enum {
+    HUD_F_MIN, HUD_F_AVG, HUD_F_P99,
+    HUD_F_FPS, HUD_F_FRAMES,
+    HUD_F_FILL, HUD_F_BLIT,
+    HUD_F_QUEUE, HUD_F_QUEUE_SIZE, HUD_F_HEAP, HUD_F_HEAP_SIZE,
+    HUD_F_IRQ
+};
+
+typedef struct {
+    int x, y, digits;
+} hud_field_t;
+
+static uint32_t plate_pixels[HUD_WIDTH * HUD_HEIGHT];
+static uint32_t digit_pixels[10 * 8 * 8];
+static gfx_surface_t plate = {plate_pixels, HUD_WIDTH, HUD_HEIGHT, HUD_WIDTH * 4};
+static gfx_surface_t digit_strip = {digit_pixels, 10 * 8, 8, 10 * 8 * 4};
+static hud_field_t fields[HUD_MAX_FIELDS];
+static int field_count = 0;
+static int hud_ready = 0;
+
+static int hud_on = 0;
+static uint32_t values[HUD_MAX_FIELDS];
+static uint8_t shown[HUD_MAX_FIELDS];
+static hud_irq_fn irq_source = 0;
+
+// Rolling window of frame times
+static uint32_t samples[HUD_SAMPLES];
+static int sample_count = 0;
+static int sample_next = 0;
+static uint32_t frames = 0;
+
+// Counters at the last refresh, and the overlay's own pixels since then
+static uint32_t refreshed_at = 0;
+static uint32_t refreshed_frames = 0;
+static uint32_t filled_at = 0, blitted_at = 0;
+static uint32_t own_filled = 0, own_blitted = 0;
+static uint32_t irq_at[16];
+static int stale = 1;
+
+static void hud_rect(gfx_rect_t* r) {
+    r->x = gui.width - HUD_WIDTH - HUD_MARGIN;
+    r->y = HUD_MARGIN;
+    r->width = HUD_WIDTH;
+    r->height = HUD_HEIGHT;
+}
+
+// Render the plate and digit strip, and find the fields in the template
+static void hud_prepare(void) {
+    char line[HUD_COLUMNS + 1];
+    
+    gfx_begin_surface(&plate, 0, 0);
+    fill_rect(0, 0, HUD_WIDTH, HUD_HEIGHT, HUD_COLOR_BG);
+    draw_rect(0, 0, HUD_WIDTH, HUD_HEIGHT, HUD_COLOR_LABEL);
+    field_count = 0;
+    for (int l = 0; l < HUD_LINES; l++) {
+        const char* t = hud_template[l];
+        int y = HUD_PADDING + l * HUD_LINE_HEIGHT;
+        int n = 0;
+        for (; t[n] && n < HUD_COLUMNS; n++) {
+            line[n] = (t[n] == '#') ? ' ' : t[n];
+            if (t[n] == '#' && (n == 0 || t[n - 1] != '#') && field_count < HUD_MAX_FIELDS) {
+                hud_field_t* f = &fields[field_count++];
+                f->x = HUD_PADDING + n * 8;
+                f->y = y;
+                f->digits = 0;
+            }
+            if (t[n] == '#') fields[field_count - 1].digits++;
+        }
+        line[n] = 0;
+        draw_string(HUD_PADDING, y, line, HUD_COLOR_LABEL, HUD_COLOR_BG);
+    }
+    gfx_end_surface();
+    
+    // Glyphs are 7 rows tall; the fill keeps the cells' last row on the plate
+    gfx_begin_surface(&digit_strip, 0, 0);
+    fill_rect(0, 0, 10 * 8, 8, HUD_COLOR_BG);
+    draw_string(0, 0, "0123456789", HUD_COLOR_VALUE, HUD_COLOR_BG);
+    gfx_end_surface();
+    
+    hud_ready = 1;
+}
+
+void hud_set_irq_source(hud_irq_fn count) {
+    irq_source = count;
+}
+
+int hud_visible(void) {
+    return hud_on;
+}
+
+// Whether the rectangle touches the overlay plate left in the back buffer
+int hud_overlaps(int x, int y, int width, int height) {
+    if (!hud_on) return 0;
+    gfx_rect_t r;
+    hud_rect(&r);
+    return x < r.x + r.width && r.x < x + width &&
+           y < r.y + r.height && r.y < y + height;
+}
+
+void hud_toggle(void) {
+    gfx_rect_t r;
+    hud_rect(&r);
+    hud_on = !hud_on;
+    stale = 1;
+    if (!hud_on) {
+        // Uncover what the overlay hid
+        gui_redraw_rect(r.x, r.y, r.width, r.height);
+    }
+}
+
+void hud_frame_done(uint32_t frame_us) {
+    samples[sample_next] = frame_us;
+    sample_next = (sample_next + 1) % HUD_SAMPLES;
+    if (sample_count < HUD_SAMPLES) sample_count++;
+    frames++;
+}
+
+int hud_due(uint32_t now) {
+    if (!hud_on) return 0;
+    return stale || now - refreshed_at >= HUD_REFRESH_US ||
+           frames - refreshed_frames >= HUD_REFRESH_FRAMES;
+}
+
+// Recompute every value from the counters
+static void hud_refresh(uint32_t now) {
+    for (int i = 0; i < HUD_MAX_FIELDS; i++) {
+        shown[i] = 1;
+    }
+    
+    // Frame times over the window: sort a copy for the percentile
+    uint32_t sorted[HUD_SAMPLES];
+    uint32_t sum = 0;
+    for (int i = 0; i < sample_count; i++) {
+        uint32_t v = samples[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+        sum += v;
+    }
+    if (sample_count > 0) {
+        values[HUD_F_MIN] = sorted[0];
+        values[HUD_F_AVG] = sum / sample_count;
+        values[HUD_F_P99] = sorted[(sample_count * 99 + 99) / 100 - 1];
+    } else {
+        values[HUD_F_MIN] = values[HUD_F_AVG] = values[HUD_F_P99] = 0;
+    }
+    
+    // Rates over the time since the last refresh
+    uint32_t elapsed_ms = (now - refreshed_at) / 1000;
+    uint32_t new_frames = frames - refreshed_frames;
+    values[HUD_F_FPS] = elapsed_ms ? new_frames * 1000 / elapsed_ms : 0;
+    values[HUD_F_FRAMES] = frames;
+    
+    uint32_t filled, blitted;
+    gfx_pixel_stats(&filled, &blitted);
+    uint32_t per = new_frames ? new_frames : 1;
+    values[HUD_F_FILL] = (filled - filled_at - own_filled) / per;
+    values[HUD_F_BLIT] = (blitted - blitted_at - own_blitted) / per;
+    filled_at = filled;
+    blitted_at = blitted;
+    own_filled = own_blitted = 0;
+    
+    values[HUD_F_QUEUE] = gui.event_peak;
+    values[HUD_F_QUEUE_SIZE] = GUI_EVENT_QUEUE_SIZE;
+    gui.event_peak = (gui.event_tail - gui.event_head + GUI_EVENT_QUEUE_SIZE) % GUI_EVENT_QUEUE_SIZE;
+    
+    size_t heap_used, heap_total;
+    heap_stats(&heap_used, &heap_total);
+    values[HUD_F_HEAP] = heap_used / 1024;
+    values[HUD_F_HEAP_SIZE] = heap_total / 1024;
+    
+    // The first lines that have fired at all
+    int shown_irqs = 0;
+    for (int irq = 0; irq < 16; irq++) {
+        uint32_t count = irq_source ? irq_source(irq) : 0;
+        if (count && shown_irqs < HUD_MAX_IRQS) {
+            values[HUD_F_IRQ + 2 * shown_irqs] = irq;
+            values[HUD_F_IRQ + 2 * shown_irqs + 1] = elapsed_ms ? (count - irq_at[irq]) * 1000 / elapsed_ms : 0;
+            shown_irqs++;
+        }
+        irq_at[irq] = count;
+    }
+    for (int i = shown_irqs; i < HUD_MAX_IRQS; i++) {
+        shown[HUD_F_IRQ + 2 * i] = shown[HUD_F_IRQ + 2 * i + 1] = 0;
+    }
+    
+    refreshed_at = now;
+    refreshed_frames = frames;
+}
+
+// Right-aligned digits from the strip; all 9s if the value does not fit
+static void hud_number(int x, int y, int digits, uint32_t value) {
+    char buf[10];
+    int n = 0;
+    do {
+        buf[n++] = (char)(value % 10);
+        value /= 10;
+    } while (value && n < 10);
+    if (value || n > digits) {
+        n = digits;
+        for (int i = 0; i < n; i++) buf[i] = 9;
+    }
+    
+    x += (digits - 1) * 8;
+    for (int i = 0; i < n; i++, x -= 8) {
+        gfx_rect_t cell = {buf[i] * 8, 0, 8, 8};
+        gfx_blit(0, x, y, &digit_strip, &cell);
+    }
+}
+
+// Draw the overlay over this frame's drawing: always when the values
+// changed, otherwise only if something painted over it
+void hud_draw(uint32_t now) {
+    if (!hud_on || !gui.framebuffer) return;
+    
+    int refresh = hud_due(now);
+    gfx_rect_t r;
+    hud_rect(&r);
+    if (!refresh && !gfx_damage_overlaps(r.x, r.y, r.width, r.height)) return;
+    
+    if (!hud_ready) hud_prepare();
+    if (refresh) {
+        hud_refresh(now);
+        stale = 0;
+    }
+    
+    uint32_t filled, blitted;
+    gfx_pixel_stats(&filled, &blitted);
+    uint32_t start_filled = filled, start_blitted = blitted;
+    
+    gfx_blit(0, r.x, r.y, &plate, 0);
+    for (int i = 0; i < field_count; i++) {
+        if (shown[i]) {
+            hud_number(r.x + fields[i].x, r.y + fields[i].y, fields[i].digits, values[i]);
+        }
+    }
+    
+    gfx_pixel_stats(&filled, &blitted);
+    own_filled += filled - start_filled;
+    own_blitted += blitted - start_blitted;
+}
@@ -79,6 +79,31 @@ static uint8_t mouse_read() {
     return inb(MOUSE_DATA_PORT);
 }
 
+// Have the controller raise IRQ 1 and IRQ 12 whenever a keyboard or mouse
+// byte arrives, so the GUI loop can sleep until there is input. The bytes
+// themselves are still read by polling.
+void ps2_enable_irqs() {
+    // A pending keyboard or mouse byte would be taken for the reply
+    int drain = 64;
+    while ((inb(MOUSE_STATUS_PORT) & MOUSE_STATUS_OUT_BUFFER) && --drain > 0) {
+        inb(MOUSE_DATA_PORT);
+    }
+    
+    mouse_wait(1);
+    outb(MOUSE_COMMAND_PORT, 0x20);  // Read configuration byte
+    int timeout = 100000;
+    while (!(inb(MOUSE_STATUS_PORT) & MOUSE_STATUS_OUT_BUFFER)) {
+        // No reply: leave the configuration alone rather than write junk
+        if (--timeout == 0) return;
+    }
+    uint8_t config = inb(MOUSE_DATA_PORT);
+    
+    mouse_wait(1);
+    outb(MOUSE_COMMAND_PORT, 0x60);  // Write configuration byte
+    mouse_wait(1);
+    outb(MOUSE_DATA_PORT, config | 0x03);
+}
+
 // Process a complete mouse packet
 static void process_mouse_packet() {
     int buttons = 0;
@@ -115,6 +140,9 @@ static void process_mouse_packet() {
     if (g_mouse_x >= gui.width) g_mouse_x = gui.width - 1;
     if (g_mouse_y >= gui.height) g_mouse_y = gui.height - 1;
     
+    // Move the pointer layer; only its old and new cells are presented
+    draw_mouse_cursor(g_mouse_x, g_mouse_y);
+    
     // Check for button changes
     int button_changed = (g_mouse_buttons != buttons);
     int button_pressed = (~g_mouse_buttons) & buttons;
@@ -226,17 +254,17 @@ void mouse_init() {
     // Enable IRQ12 on PIC (would need PIC setup)
     // For now, we'll poll in the event loop
     
-    // Mouse cursor is drawn by desktop.c
+    // The cursor is drawn by gfx.c, over every present
 }
 
 // Clear mouse cursor (restore background)
 void clear_mouse_cursor(int x, int y) {
-    // This needs to save and restore the background
-    // For now, we just redraw the screen portion that was covered
-    // A proper implementation would save the background before drawing
+    (void)x;
+    (void)y;
     
-    // Request redraw of cursor area
-    gui.needs_redraw = 1;
+    // The cursor is never in the scene, so hiding it just presents the
+    // pixels it covered
+    hide_mouse_cursor();
 }
 
 // Enable mouse streaming
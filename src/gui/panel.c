@@ -0,0 +1,378 @@
+#include "gui.h"
+#include "../graphics/span.h"
+
+// Frosted panels. When a repaint covers a panel, the scene under it is
+// already in the render target: it is shrunk by the blur level's factor,
+// box blurred there (separable, with the span accumulators), tinted and
+// stretched back up bilinearly into the panel's surface. The surface is
+// kept until the shrunk backdrop hashes differently, so repainting a panel
+// over an unchanged scene costs the shrink and one blit.
+#define PANEL_MAX_RADIUS        3
+#define PANEL_RECOVER_FRAMES    64
+
+typedef struct {
+    int shift;      // The backdrop is shrunk 1 << shift times each way
+    int radius;     // Box radius, in shrunk pixels
+    int passes;     // Box passes; three come close to a Gaussian
+} blur_level_t;
+
+// Finest first; each level blurs about as far on screen as the others
+static const blur_level_t blur_levels[] = {
+    {1, 3, 3},
+    {2, 2, 2},
+    {3, 1, 2},
+};
+#define BLUR_LEVELS ((int)(sizeof(blur_levels) / sizeof(blur_levels[0])))
+
+static panel_t* g_panels = 0;
+static int g_level = 0;
+static int g_blurred = 0;       // A panel was re-blurred since the last frame
+static int g_fast_frames = 0;
+
+static inline int shrunk(int size, int shift) {
+    return (size + (1 << shift) - 1) >> shift;
+}
+
+// Create a panel over the given screen area (clipped to the screen)
+panel_t* panel_create(int x, int y, int width, int height, uint32_t tint, uint32_t tint_alpha) {
+    // Panels stay on screen, so the backdrop can be read as whole rows
+    if (x < 0) { width += x; x = 0; }
+    if (y < 0) { height += y; y = 0; }
+    if (x + width > gui.width) width = gui.width - x;
+    if (y + height > gui.height) height = gui.height - y;
+    if (width <= 0 || height <= 0) return 0;
+    
+    panel_t* panel = (panel_t*)malloc(sizeof(panel_t));
+    if (!panel) return 0;
+    
+    // Work buffers are sized for the finest level: the shrunk image twice,
+    // its rows at full width, one padded row and a row of sums
+    int sw = shrunk(width, blur_levels[0].shift);
+    int sh = shrunk(height, blur_levels[0].shift);
+    size_t words = 2 * (size_t)sw * sh + (size_t)width * sh + sw + 2 * PANEL_MAX_RADIUS + 2 * (size_t)width;
+    uint32_t* work = (uint32_t*)malloc(words * 4);
+    uint32_t* pixels = (uint32_t*)malloc((size_t)width * height * 4);
+    if (!work || !pixels) {
+        free(work);
+        free(pixels);
+        free(panel);
+        return 0;
+    }
+    
+    panel->next = 0;
+    panel->x = x;
+    panel->y = y;
+    panel->width = width;
+    panel->height = height;
+    panel->tint = tint;
+    panel->tint_alpha = tint_alpha;
+    panel->draw = 0;
+    panel->data = 0;
+    panel->surface.pixels = pixels;
+    panel->surface.width = width;
+    panel->surface.height = height;
+    panel->surface.pitch = width * 4;
+    panel->small = work;
+    panel->scratch = panel->small + (size_t)sw * sh;
+    panel->wide = panel->scratch + (size_t)sw * sh;
+    panel->pad = panel->wide + (size_t)width * sh;
+    panel->sums = (uint16_t*)(panel->pad + sw + 2 * PANEL_MAX_RADIUS);
+    panel->backdrop_hash = 0;
+    panel->cache_level = -1;
+    panel->dirty = 0;
+    
+    // Later panels are painted over earlier ones
+    panel_t** ptr = &g_panels;
+    while (*ptr) {
+        ptr = &(*ptr)->next;
+    }
+    *ptr = panel;
+    
+    gui.needs_redraw = 1;
+    return panel;
+}
+
+// Destroy a panel
+void panel_destroy(panel_t* panel) {
+    if (!panel) return;
+    
+    panel_t** ptr = &g_panels;
+    while (*ptr && *ptr != panel) {
+        ptr = &(*ptr)->next;
+    }
+    if (*ptr) {
+        *ptr = panel->next;
+    }
+    if (gui.taskbar_panel == panel) gui.taskbar_panel = 0;
+    
+    // The work buffers are one block starting at small, which may have
+    // been swapped with scratch by the last blur
+    free(panel->small < panel->scratch ? panel->small : panel->scratch);
+    free(panel->surface.pixels);
+    free(panel);
+    
+    gui.needs_redraw = 1;
+}
+
+// Shrink the backdrop under the panel into small: each pixel is the
+// average of a block, with blocks past the edges repeating the last row or
+// column
+static void panel_shrink(panel_t* p, int shift, int sw, int sh) {
+    gfx_surface_t target;
+    gfx_target_surface(&target);
+    int f = 1 << shift;
+    
+    for (int j = 0; j < sh; j++) {
+        span_fill32((uint32_t*)p->sums, 0, 2 * p->width);
+        for (int k = 0; k < f; k++) {
+            int y = j * f + k;
+            if (y >= p->height) y = p->height - 1;
+            const uint32_t* row = (const uint32_t*)((const uint8_t*)target.pixels + (p->y + y) * target.pitch);
+            span_sum_add32(p->sums, row + p->x, p->width);
+        }
+        
+        uint32_t* out = p->small + j * sw;
+        for (int i = 0; i < sw; i++) {
+            uint32_t c[4] = {0, 0, 0, 0};
+            for (int k = 0; k < f; k++) {
+                int x = i * f + k;
+                if (x >= p->width) x = p->width - 1;
+                for (int ch = 0; ch < 4; ch++) {
+                    c[ch] += p->sums[x * 4 + ch];
+                }
+            }
+            out[i] = (c[0] >> (2 * shift)) | ((c[1] >> (2 * shift)) << 8) |
+                     ((c[2] >> (2 * shift)) << 16) | ((c[3] >> (2 * shift)) << 24);
+        }
+    }
+}
+
+// Horizontal box pass, in place: each row is padded with copies of its
+// edge pixels and the 2r + 1 shifted copies are summed
+static void blur_rows(panel_t* p, int sw, int sh, int r) {
+    uint32_t scale = (65536 + 2 * r) / (2 * r + 1);
+    for (int j = 0; j < sh; j++) {
+        uint32_t* row = p->small + j * sw;
+        for (int i = 0; i < r; i++) {
+            p->pad[i] = row[0];
+            p->pad[r + sw + i] = row[sw - 1];
+        }
+        span_move32(p->pad + r, row, sw);
+        
+        span_fill32((uint32_t*)p->sums, 0, 2 * sw);
+        for (int k = 0; k <= 2 * r; k++) {
+            span_sum_add32(p->sums, p->pad + k, sw);
+        }
+        span_sum_scale32(row, p->sums, sw, scale);
+    }
+}
+
+// Vertical box pass into scratch, with a running sum over the rows in the
+// window; then scratch becomes the image
+static void blur_columns(panel_t* p, int sw, int sh, int r) {
+    uint32_t scale = (65536 + 2 * r) / (2 * r + 1);
+
+#define SHRUNK_ROW(j) (p->small + ((j) < 0 ? 0 : (j) >= sh ? sh - 1 : (j)) * sw)
+    span_fill32((uint32_t*)p->sums, 0, 2 * sw);
+    for (int k = -r; k <= r; k++) {
+        span_sum_add32(p->sums, SHRUNK_ROW(k), sw);
+    }
+    for (int j = 0; j < sh; j++) {
+        span_sum_scale32(p->scratch + j * sw, p->sums, sw, scale);
+        span_sum_add32(p->sums, SHRUNK_ROW(j + r + 1), sw);
+        span_sum_sub32(p->sums, SHRUNK_ROW(j - r), sw);
+    }
+#undef SHRUNK_ROW
+    
+    uint32_t* t = p->small;
+    p->small = p->scratch;
+    p->scratch = t;
+}
+
+// Where full-size pixel n samples the shrunk image, in 1/256ths of a
+// shrunk pixel (pixel centres line up)
+static inline int sample_pos(int n, int shift) {
+    int pos = ((2 * n + 1) << 7 >> shift) - 128;
+    return pos < 0 ? 0 : pos;
+}
+
+static inline uint32_t lerp_pixel(uint32_t a, uint32_t b, uint32_t w) {
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int ca = (a >> shift) & 0xFF;
+        int cb = (b >> shift) & 0xFF;
+        out |= (uint32_t)(ca + (((cb - ca) * (int)w) >> 8)) << shift;
+    }
+    return out;
+}
+
+// Stretch small back to the panel's size into its surface: rows are
+// widened into wide, then each surface row blends the two nearest
+static void panel_expand(panel_t* p, int shift, int sw, int sh) {
+    for (int j = 0; j < sh; j++) {
+        const uint32_t* src = p->small + j * sw;
+        uint32_t* dst = p->wide + j * p->width;
+        for (int x = 0; x < p->width; x++) {
+            int pos = sample_pos(x, shift);
+            int i = pos >> 8;
+            if (i >= sw - 1) {
+                dst[x] = src[sw - 1];
+            } else {
+                dst[x] = lerp_pixel(src[i], src[i + 1], pos & 0xFF);
+            }
+        }
+    }
+    
+    for (int y = 0; y < p->height; y++) {
+        int pos = sample_pos(y, shift);
+        int j = pos >> 8;
+        uint32_t* out = p->surface.pixels + y * p->width;
+        if (j >= sh - 1) {
+            span_move32(out, p->wide + (sh - 1) * p->width, p->width);
+        } else {
+            span_move32(out, p->wide + j * p->width, p->width);
+            if (pos & 0xFF) {
+                span_fade32(out, p->wide + (j + 1) * p->width, p->width, pos & 0xFF);
+            }
+        }
+    }
+}
+
+// Bring the panel's surface up to date with the backdrop under it
+static void panel_update(panel_t* p) {
+    const blur_level_t* level = &blur_levels[g_level];
+    int sw = shrunk(p->width, level->shift);
+    int sh = shrunk(p->height, level->shift);
+    
+    panel_shrink(p, level->shift, sw, sh);
+    uint32_t hash = span_hash32(p->small, sw * sh, (uint32_t)g_level);
+    if (p->cache_level == g_level && p->backdrop_hash == hash) return;
+    
+    for (int i = 0; i < level->passes; i++) {
+        blur_rows(p, sw, sh, level->radius);
+        blur_columns(p, sw, sh, level->radius);
+    }
+    
+    // Tinting is linear, so it is done before stretching
+    if (p->tint_alpha) {
+        span_fill32(p->scratch, p->tint, sw);
+        for (int j = 0; j < sh; j++) {
+            span_fade32(p->small + j * sw, p->scratch, sw, p->tint_alpha);
+        }
+    }
+    
+    panel_expand(p, level->shift, sw, sh);
+    p->backdrop_hash = hash;
+    p->cache_level = g_level;
+    g_blurred = 1;
+}
+
+// Paint the panels that lie wholly inside the clip over what has been
+// drawn there. One cut by the clip is left alone: its blur would mix in
+// stale pixels from outside, so gui_redraw_rect() marks it to be repainted
+// whole before the frame is presented.
+void panels_paint(void) {
+    gfx_rect_t clip;
+    gfx_get_clip(&clip);
+    
+    for (panel_t* p = g_panels; p; p = p->next) {
+        if (p->x < clip.x || p->y < clip.y ||
+            p->x + p->width > clip.x + clip.width ||
+            p->y + p->height > clip.y + clip.height) {
+            continue;
+        }
+        
+        p->dirty = 0;
+        panel_update(p);
+        gfx_blit(0, p->x, p->y, &p->surface, 0);
+        if (p->draw) {
+            gfx_push_clip(p->x, p->y, p->width, p->height);
+            p->draw(p);
+            gfx_pop_clip();
+        }
+    }
+}
+
+static inline int rects_overlap(int x1, int y1, int w1, int h1, int x2, int y2, int w2, int h2) {
+    return x1 < x2 + w2 && x2 < x1 + w1 && y1 < y2 + h2 && y2 < y1 + h1;
+}
+
+// Whether any panel overlaps the rectangle
+int panels_overlap(int x, int y, int width, int height) {
+    for (panel_t* p = g_panels; p; p = p->next) {
+        if (rects_overlap(x, y, width, height, p->x, p->y, p->width, p->height)) return 1;
+    }
+    return 0;
+}
+
+// Mark the panels a repaint of the rectangle cut: they are repainted whole
+// by the next panels_dirty_rect() round, however many repaints cut them
+void panels_invalidate(int x, int y, int width, int height) {
+    for (panel_t* p = g_panels; p; p = p->next) {
+        if (rects_overlap(x, y, width, height, p->x, p->y, p->width, p->height) &&
+            (p->x < x || p->y < y ||
+             p->x + p->width > x + width || p->y + p->height > y + height)) {
+            p->dirty = 1;
+        }
+    }
+}
+
+// Area to repaint for the first dirty panel: its box, grown until it cuts
+// no panel (panels can overlap). Painting it clears the flags of every
+// panel inside. Returns 0 once no panel is dirty.
+int panels_dirty_rect(gfx_rect_t* rect) {
+    panel_t* first = g_panels;
+    while (first && !first->dirty) {
+        first = first->next;
+    }
+    if (!first) return 0;
+    
+    int x1 = first->x;
+    int y1 = first->y;
+    int x2 = first->x + first->width;
+    int y2 = first->y + first->height;
+    int grown = 1;
+    while (grown) {
+        grown = 0;
+        for (panel_t* p = g_panels; p; p = p->next) {
+            int px2 = p->x + p->width;
+            int py2 = p->y + p->height;
+            if (p->x >= x1 && p->y >= y1 && px2 <= x2 && py2 <= y2) continue;
+            if (!rects_overlap(x1, y1, x2 - x1, y2 - y1, p->x, p->y, p->width, p->height)) continue;
+            
+            if (p->x < x1) x1 = p->x;
+            if (p->y < y1) y1 = p->y;
+            if (px2 > x2) x2 = px2;
+            if (py2 > y2) y2 = py2;
+            grown = 1;
+        }
+    }
+    
+    rect->x = x1;
+    rect->y = y1;
+    rect->width = x2 - x1;
+    rect->height = y2 - y1;
+    return 1;
+}
+
+// Quality control, once per rendered frame: step the blur down when a
+// frame that re-blurred a panel overran, and back up after a run of such
+// frames in under half the budget
+void panels_frame_done(uint32_t frame_us, uint32_t budget_us) {
+    if (g_blurred) {
+        if (frame_us > budget_us) {
+            if (g_level < BLUR_LEVELS - 1) g_level++;
+            g_fast_frames = 0;
+        } else if (frame_us < budget_us / 2 && g_level > 0) {
+            if (++g_fast_frames >= PANEL_RECOVER_FRAMES) {
+                g_level--;
+                g_fast_frames = 0;
+            }
+        }
+    }
+    g_blurred = 0;
+}
+
+int panels_blur_level(void) {
+    return g_level;
+}
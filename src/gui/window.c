@@ -1,5 +1,6 @@
 #include "gui.h"
 #include "../libc_compat.h"
+#include "../graphics/gfx.h"
 
 // Hit test return values
 #define HTCAPTION      0x02
@@ -23,6 +24,22 @@
 static window_t* g_windows = 0;
 static int g_next_window_id = 1;
 
+// Occlusion state, rebuilt front to back by windows_update_visibility().
+// g_visible[i] is the part of g_visible_win[i] not hidden by anything in
+// front of it; g_desktop_visible is what is left over for the background.
+#define MAX_DRAW_WINDOWS 64
+#define MAX_CLIP_BOXES   16   // Above this, paint through the region's extents
+static window_t* g_visible_win[MAX_DRAW_WINDOWS];
+static region_t g_visible[MAX_DRAW_WINDOWS];
+static region_t g_desktop_visible;
+static int g_visible_count = 0;
+static int g_visibility_ready = 0;
+static int g_visibility_stale = 1;
+
+// Title bar button under the mouse, drawn highlighted
+static window_t* g_hover_win = 0;
+static int g_hover_button = -1;
+
 // Forward declarations
 static int hit_test_border(window_t* win, int x, int y);
 static void window_widget_draw(widget_t* widget);
@@ -60,6 +77,11 @@ window_t* window_create(int x, int y, int width, int height, const char* title)
     win->on_click = 0;
     win->content = 0;
     win->parent = 0;
+    win->surface.pixels = 0;
+    win->surface.width = 0;
+    win->surface.height = 0;
+    win->surface.pitch = 0;
+    win->surface_valid = 0;
     win->base.type = WIDGET_WINDOW;
     win->base.x = x;
     win->base.y = y;
@@ -101,9 +123,17 @@ void window_destroy(window_t* win) {
         widget_destroy(win->content);
     }
     
+    // Drop references to it
+    if (gui.active_window == win) gui.active_window = 0;
+    if (g_hover_win == win) g_hover_win = 0;
+    
     // Free window
+    free(win->surface.pixels);
     free(win);
     
+    // The occlusion lists may still point at it
+    g_visibility_stale = 1;
+    
     // Request redraw
     gui.needs_redraw = 1;
 }
@@ -112,12 +142,68 @@ void window_destroy(window_t* win) {
 void window_move(window_t* win, int x, int y) {
     if (!win) return;
     
+    int old_x = win->x;
+    int old_y = win->y;
+    if (x == old_x && y == old_y) return;
+    
     // Update position
     win->x = x;
     win->y = y;
+    g_visibility_stale = 1;
     
-    // Request redraw
-    gui.needs_redraw = 1;
+    // Only the front window's pixels can be shifted as-is, and only when the
+    // screen is otherwise up to date; anything else takes a full redraw
+    if (win != g_windows || win->is_minimized || gui.needs_redraw) {
+        gui.needs_redraw = 1;
+        return;
+    }
+    windows_update_visibility();
+    
+    // Shift what was on screen of the window above the taskbar (under it is
+    // at most backdrop), keeping the destination off the taskbar as well
+    int area_h = gui.height - gui.taskbar_height;
+    int dx = x - old_x;
+    int dy = y - old_y;
+    int x1 = old_x > 0 ? old_x : 0;
+    int y1 = old_y > 0 ? old_y : 0;
+    int x2 = old_x + win->width < gui.width ? old_x + win->width : gui.width;
+    int y2 = old_y + win->height < area_h ? old_y + win->height : area_h;
+    if (x1 + dx < 0) x1 = -dx;
+    if (y1 + dy < 0) y1 = -dy;
+    if (x2 + dx > gui.width) x2 = gui.width - dx;
+    if (y2 + dy > area_h) y2 = area_h - dy;
+    
+    // Drawn without a surface, text wraps at the right screen edge, so a
+    // window cut off there does not look the same after a move; repaint it
+    // instead of copying
+    int edge = !win->surface.pixels &&
+               ((old_x + win->width > gui.width) || (x + win->width > gui.width));
+    
+    // Pixels under a frosted panel or the overlay are not the window's
+    if (panels_overlap(x1, y1, x2 - x1, y2 - y1) ||
+        panels_overlap(x1 + dx, y1 + dy, x2 - x1, y2 - y1) ||
+        hud_overlaps(x1, y1, x2 - x1, y2 - y1) ||
+        hud_overlaps(x1 + dx, y1 + dy, x2 - x1, y2 - y1)) {
+        edge = 1;
+    }
+    
+    region_t dirty;
+    region_init_rect(&dirty, old_x, old_y, win->width, win->height);
+    region_union_rect(&dirty, &dirty, x, y, win->width, win->height);
+    if (!edge && x1 < x2 && y1 < y2) {
+        gfx_copy_rect(x1, y1, x2 - x1, y2 - y1, x1 + dx, y1 + dy);
+        region_subtract_rect(&dirty, &dirty, x1 + dx, y1 + dy, x2 - x1, y2 - y1);
+    }
+    
+    // Repaint the uncovered strips behind the old position and any part of
+    // the window that was off screen before
+    int count;
+    const region_box_t* boxes = region_boxes(&dirty, &count);
+    for (int i = 0; i < count; i++) {
+        gui_redraw_rect(boxes[i].x1, boxes[i].y1,
+                        boxes[i].x2 - boxes[i].x1, boxes[i].y2 - boxes[i].y1);
+    }
+    region_fini(&dirty);
 }
 
 // Resize a window
@@ -140,7 +226,7 @@ void window_resize(window_t* win, int width, int height) {
 void window_set_title(window_t* win, const char* title) {
     if (!win) return;
     win->title = title;
-    gui.needs_redraw = 1;
+    window_invalidate(win);
 }
 
 // Bring window to front
@@ -160,8 +246,12 @@ void window_bring_to_front(window_t* win) {
     win->base.next = (widget_t*)g_windows;
     g_windows = win;
     
-    // Set as active
-    gui.active_window = win;
+    // Set as active; both title bars change colour
+    if (gui.active_window != win) {
+        window_invalidate(gui.active_window);
+        window_invalidate(win);
+        gui.active_window = win;
+    }
     
     // Request redraw
     gui.needs_redraw = 1;
@@ -205,7 +295,7 @@ void window_toggle_maximize(window_t* win) {
         win->is_maximized = 1;
     }
     
-    gui.needs_redraw = 1;
+    window_invalidate(win);
 }
 
 // Close window
@@ -262,60 +352,145 @@ static int hit_test_border(window_t* win, int x, int y) {
     return HTCLIENT;
 }
 
-// Draw window frame (title bar and borders)
-static void draw_window_frame(window_t* win) {
-    // Draw title bar
-    fill_rect(win->x, win->y, win->width, WINDOW_TITLE_HEIGHT, 
-              win->is_maximized ? WINDOW_TITLE_COLOR : GUI_COLOR_TITLE_BAR);
-    
-    // Draw title text
-    if (win->title) {
-        int text_x = win->x + 4;
-        draw_string(text_x, win->y + 6, win->title, GUI_COLOR_WHITE, GUI_COLOR_TITLE_BAR);
+// Title bar buttons and their sprites. RESTORE replaces MAXIMIZE on a
+// maximized window.
+enum {
+    CHROME_CLOSE = 0,
+    CHROME_MINIMIZE,
+    CHROME_MAXIMIZE,
+    CHROME_RESTORE,
+    CHROME_BUTTONS
+};
+#define CHROME_BUTTON_SIZE 16
+
+// Chrome sprites, rendered from g_theme by chrome_update(): a one pixel
+// wide title bar column per active state, stretched across the window, and
+// every button in its normal and hovered look
+static window_theme_t g_theme = {
+    GUI_COLOR_TITLE_BAR, GUI_COLOR_TITLE_BAR_INACTIVE, GUI_COLOR_WHITE,
+    GUI_COLOR_LIGHT_GRAY, GUI_COLOR_BUTTON_HOVER, GUI_COLOR_DARK_GRAY,
+    GUI_COLOR_BLACK, GUI_COLOR_RED
+};
+static int g_chrome_ready = 0;
+static uint32_t g_title_column[2][WINDOW_TITLE_HEIGHT];
+static uint32_t g_button_pixels[CHROME_BUTTONS][2][CHROME_BUTTON_SIZE * CHROME_BUTTON_SIZE];
+static gfx_surface_t g_button_sprite[CHROME_BUTTONS][2];
+
+// Draw one button face at the origin of the current target
+static void chrome_draw_button(int button, int hover) {
+    const int size = CHROME_BUTTON_SIZE;
+    
+    fill_rect(0, 0, size, size, hover ? g_theme.button_hover : g_theme.button);
+    switch (button) {
+        case CHROME_CLOSE:
+            draw_line(4, 4, 12, 12, g_theme.close_mark);
+            draw_line(12, 4, 4, 12, g_theme.close_mark);
+            break;
+        case CHROME_MINIMIZE:
+            draw_line(4, 8, 12, 8, g_theme.button_glyph);
+            break;
+        case CHROME_MAXIMIZE:
+            fill_rect(5, 5, 8, 8, g_theme.button_glyph);
+            break;
+        case CHROME_RESTORE:
+            fill_rect(4, 6, 8, 6, g_theme.button_glyph);
+            draw_rect(3, 5, 10, 8, g_theme.button_glyph);
+            break;
+    }
+    draw_rect(0, 0, size, size, g_theme.button_border);
+}
+
+// Render the chrome sprites if the theme changed since they were made.
+// Must not run while drawing into a window surface (targets do not nest).
+static void chrome_update(void) {
+    if (g_chrome_ready) return;
+    
+    for (int row = 0; row < WINDOW_TITLE_HEIGHT; row++) {
+        g_title_column[0][row] = g_theme.title_inactive;
+        g_title_column[1][row] = g_theme.title_active;
     }
     
-    // Draw close button
-    if (win->flags & WINDOW_FLAG_HAS_CLOSE) {
-        int btn_x = win->x + win->width - BUTTON_CLOSE_X - 8;
-        int btn_y = win->y + 4;
-        
-        // Close button background
-        fill_rect(btn_x, btn_y, 16, 16, GUI_COLOR_LIGHT_GRAY);
-        
-        // Close X mark
-        draw_line(btn_x + 4, btn_y + 4, btn_x + 12, btn_y + 12, GUI_COLOR_RED);
-        draw_line(btn_x + 12, btn_y + 4, btn_x + 4, btn_y + 12, GUI_COLOR_RED);
-        
-        // Border
-        draw_rect(btn_x, btn_y, 16, 16, GUI_COLOR_DARK_GRAY);
+    for (int button = 0; button < CHROME_BUTTONS; button++) {
+        for (int hover = 0; hover < 2; hover++) {
+            gfx_surface_t* sprite = &g_button_sprite[button][hover];
+            sprite->pixels = g_button_pixels[button][hover];
+            sprite->width = CHROME_BUTTON_SIZE;
+            sprite->height = CHROME_BUTTON_SIZE;
+            sprite->pitch = CHROME_BUTTON_SIZE * 4;
+            
+            gfx_begin_surface(sprite, 0, 0);
+            chrome_draw_button(button, hover);
+            gfx_end_surface();
+        }
+    }
+    g_chrome_ready = 1;
+}
+
+// Replace the chrome colours; every window is re-rendered with them
+void window_set_theme(const window_theme_t* theme) {
+    if (!theme) return;
+    g_theme = *theme;
+    g_chrome_ready = 0;
+    for (window_t* win = g_windows; win; win = (window_t*)win->base.next) {
+        window_invalidate(win);
+    }
+}
+
+// Left edge of a title bar button, or -1 if the window does not have it
+static int chrome_button_x(window_t* win, int button) {
+    switch (button) {
+        case CHROME_CLOSE:
+            if (!(win->flags & WINDOW_FLAG_HAS_CLOSE)) return -1;
+            return win->x + win->width - BUTTON_CLOSE_X - 8;
+        case CHROME_MINIMIZE:
+            if (!(win->flags & WINDOW_FLAG_HAS_MINIMIZE)) return -1;
+            return win->x + win->width - BUTTON_CLOSE_X - 28;
+        case CHROME_MAXIMIZE:
+            if (!(win->flags & WINDOW_FLAG_HAS_MAXIMIZE)) return -1;
+            return win->x + win->width - BUTTON_CLOSE_X - 48;
+    }
+    return -1;
+}
+
+// Title bar button at a screen position, or -1
+static int chrome_button_at(window_t* win, int x, int y) {
+    int btn_y = win->y + 4;
+    if (y < btn_y || y >= btn_y + CHROME_BUTTON_SIZE) return -1;
+    
+    for (int button = CHROME_CLOSE; button <= CHROME_MAXIMIZE; button++) {
+        int btn_x = chrome_button_x(win, button);
+        if (btn_x >= 0 && x >= btn_x && x < btn_x + CHROME_BUTTON_SIZE) {
+            return button;
+        }
+    }
+    return -1;
+}
+
+// Draw window frame (title bar and borders) from the chrome sprites
+static void draw_window_frame(window_t* win) {
+    // Title bar: stretch the column sprite, one fill per run of equal rows
+    const uint32_t* column = g_title_column[win == gui.active_window];
+    int row = 0;
+    while (row < WINDOW_TITLE_HEIGHT) {
+        int run = 1;
+        while (row + run < WINDOW_TITLE_HEIGHT && column[row + run] == column[row]) run++;
+        fill_rect(win->x, win->y + row, win->width, run, column[row]);
+        row += run;
     }
     
-    // Draw minimize button
-    if (win->flags & WINDOW_FLAG_HAS_MINIMIZE) {
-        int btn_x = win->x + win->width - BUTTON_CLOSE_X - 28;
-        int btn_y = win->y + 4;
-        
-        fill_rect(btn_x, btn_y, 16, 16, GUI_COLOR_LIGHT_GRAY);
-        draw_line(btn_x + 4, btn_y + 8, btn_x + 12, btn_y + 8, GUI_COLOR_BLACK);
-        draw_rect(btn_x, btn_y, 16, 16, GUI_COLOR_DARK_GRAY);
+    // Draw title text
+    if (win->title) {
+        draw_string_transparent(win->x + 4, win->y + 6, win->title, g_theme.title_text);
     }
     
-    // Draw maximize button
-    if (win->flags & WINDOW_FLAG_HAS_MAXIMIZE) {
-        int btn_x = win->x + win->width - BUTTON_CLOSE_X - 48;
-        int btn_y = win->y + 4;
-        
-        fill_rect(btn_x, btn_y, 16, 16, GUI_COLOR_LIGHT_GRAY);
+    // Buttons
+    for (int button = CHROME_CLOSE; button <= CHROME_MAXIMIZE; button++) {
+        int btn_x = chrome_button_x(win, button);
+        if (btn_x < 0) continue;
         
-        if (win->is_maximized) {
-            // Restore icon
-            fill_rect(btn_x + 4, btn_y + 6, 8, 6, GUI_COLOR_BLACK);
-            draw_rect(btn_x + 3, btn_y + 5, 10, 8, GUI_COLOR_BLACK);
-        } else {
-            // Maximize icon
-            fill_rect(btn_x + 5, btn_y + 5, 8, 8, GUI_COLOR_BLACK);
-        }
-        draw_rect(btn_x, btn_y, 16, 16, GUI_COLOR_DARK_GRAY);
+        int hover = (win == g_hover_win && button == g_hover_button);
+        int sprite = (button == CHROME_MAXIMIZE && win->is_maximized) ? CHROME_RESTORE : button;
+        gfx_blit(0, btn_x, win->y + 4, &g_button_sprite[sprite][hover], 0);
     }
     
     // Draw border
@@ -324,6 +499,20 @@ static void draw_window_frame(window_t* win) {
     }
 }
 
+// Track which title bar button is under the mouse, re-rendering the
+// windows whose highlight changes
+void windows_update_hover(int x, int y) {
+    window_t* win = window_at(x, y);
+    int button = win ? chrome_button_at(win, x, y) : -1;
+    if (button < 0) win = 0;
+    if (win == g_hover_win && button == g_hover_button) return;
+    
+    window_invalidate(g_hover_win);
+    window_invalidate(win);
+    g_hover_win = win;
+    g_hover_button = button;
+}
+
 // Draw window content area
 static void draw_window_content(window_t* win) {
     // Draw client area background
@@ -332,43 +521,181 @@ static void draw_window_content(window_t* win) {
     int client_w = win->width - 2;
     int client_h = win->height - WINDOW_TITLE_HEIGHT - 1;
     
+    // Maximized windows have no border, so the client area reaches the edges;
+    // every window must be opaque over its whole rectangle for occlusion
+    if (win->is_maximized) {
+        client_x = win->x;
+        client_w = win->width;
+        client_h = win->height - WINDOW_TITLE_HEIGHT;
+    }
+    
     if (client_w > 0 && client_h > 0) {
         fill_rect(client_x, client_y, client_w, client_h, win->bg_color);
     }
 }
 
-// Draw a window
+// Run the window's drawing code: frame, client area, then widgets
+static void window_paint(window_t* win) {
+    draw_window_frame(win);
+    draw_window_content(win);
+    if (win->content) {
+        widget_draw(win->content);
+    }
+}
+
+// Bring the retained surface up to date, (re)allocating it whenever the
+// window's size changes. Returns 0 if there is no surface to draw from.
+static int window_update_surface(window_t* win) {
+    gfx_surface_t* surface = &win->surface;
+    if (win->width <= 0 || win->height <= 0) return 0;
+    
+    if (surface->width != win->width || surface->height != win->height) {
+        free(surface->pixels);
+        surface->pixels = (uint32_t*)malloc((size_t)win->width * win->height * 4);
+        surface->width = surface->pixels ? win->width : 0;
+        surface->height = surface->pixels ? win->height : 0;
+        surface->pitch = surface->width * 4;
+        win->surface_valid = 0;
+    }
+    if (!surface->pixels) return 0;
+    
+    if (!win->surface_valid) {
+        chrome_update();
+        gfx_begin_surface(surface, win->x, win->y);
+        window_paint(win);
+        gfx_end_surface();
+        win->surface_valid = 1;
+    }
+    return 1;
+}
+
+// Mark the window's contents as changed: its surface is re-rendered the
+// next time the window is drawn. Call after changing window fields directly.
+void window_invalidate(window_t* win) {
+    if (!win) return;
+    win->surface_valid = 0;
+    gui.needs_redraw = 1;
+}
+
+// Draw a window. Normally this is a blit of its retained surface; without
+// one (out of memory) the window is painted directly.
 void window_draw(window_t* win) {
     if (!win || win->is_minimized) return;
     
-    // Draw frame first
-    draw_window_frame(win);
+    if (window_update_surface(win)) {
+        gfx_blit(0, win->x, win->y, &win->surface, 0);
+        return;
+    }
     
-    // Draw content
-    draw_window_content(win);
+    // Keep everything the window paints inside its own rectangle
+    chrome_update();
+    gfx_push_clip(win->x, win->y, win->width, win->height);
+    window_paint(win);
+    gfx_pop_clip();
+}
+
+// Compute, front to back, the visible region of every window and of the
+// desktop. An opaque taskbar is painted over everything, so it starts out
+// covered; behind a frosted one the scene is drawn as its backdrop.
+// If the region pool runs out the covered area can no longer be trusted, so
+// every window and the whole desktop are marked visible instead and drawing
+// degrades to the plain back-to-front painter's algorithm.
+void windows_update_visibility() {
+    if (!g_visibility_ready) {
+        for (int i = 0; i < MAX_DRAW_WINDOWS; i++) {
+            region_init(&g_visible[i]);
+        }
+        region_init(&g_desktop_visible);
+        g_visibility_ready = 1;
+    }
     
-    // Draw widgets if any
-    if (win->content) {
-        widget_draw(win->content);
+    // Drop last frame's regions so their boxes go back to the pool
+    for (int i = 0; i < g_visible_count; i++) {
+        region_clear(&g_visible[i]);
+    }
+    region_clear(&g_desktop_visible);
+    
+    int desktop_h = gui.height - (gui.taskbar_panel ? 0 : gui.taskbar_height);
+    region_t covered;
+    region_init_rect(&covered, 0, desktop_h, gui.width, gui.height - desktop_h);
+    int exact = 1;
+    
+    g_visible_count = 0;
+    for (window_t* win = g_windows; win && g_visible_count < MAX_DRAW_WINDOWS;
+         win = (window_t*)win->base.next) {
+        if (win->is_minimized) continue;
+        
+        region_t* vis = &g_visible[g_visible_count];
+        g_visible_win[g_visible_count++] = win;
+        
+        region_init_rect(vis, win->x, win->y, win->width, win->height);
+        region_intersect_rect(vis, vis, 0, 0, gui.width, gui.height);
+        if (exact) {
+            region_subtract(vis, vis, &covered);
+            exact = region_union_rect(&covered, &covered, win->x, win->y, win->width, win->height);
+        }
+    }
+    
+    region_init_rect(&g_desktop_visible, 0, 0, gui.width, desktop_h);
+    if (exact) {
+        region_subtract(&g_desktop_visible, &g_desktop_visible, &covered);
+    } else {
+        for (int i = 0; i < g_visible_count; i++) {
+            window_t* win = g_visible_win[i];
+            // Hand back whatever the subtraction took from the pool first
+            region_fini(&g_visible[i]);
+            region_init_rect(&g_visible[i], win->x, win->y, win->width, win->height);
+        }
     }
+    
+    region_fini(&covered);
+    g_visibility_stale = 0;
+}
+
+// Desktop area left uncovered by windows and an opaque taskbar
+const region_t* windows_desktop_region() {
+    if (g_visibility_stale) {
+        windows_update_visibility();
+    }
+    return &g_desktop_visible;
 }
 
 // Draw all windows
 void windows_draw_all() {
-    // Draw from back to front (reverse order of linked list)
-    // We need to build a list first, then draw in reverse
-    window_t* list[64];
-    int count = 0;
-    
-    for (window_t* win = g_windows; win && count < 64; win = (window_t*)win->base.next) {
-        list[count++] = win;
+    if (g_visibility_stale) {
+        windows_update_visibility();
     }
     
-    // Draw from back to front
-    for (int i = count - 1; i >= 0; i--) {
-        window_t* win = list[i];
-        if (!win->is_minimized) {
+    // Draw from back to front, each window clipped to its visible boxes.
+    // Painting a superset of a visible region (extents, or an inexact region)
+    // is still correct because windows in front are drawn afterwards.
+    gfx_rect_t clip;
+    gfx_get_clip(&clip);
+    
+    for (int i = g_visible_count - 1; i >= 0; i--) {
+        window_t* win = g_visible_win[i];
+        int count;
+        const region_box_t* boxes = region_boxes(&g_visible[i], &count);
+        
+        // Fully hidden
+        if (count == 0) continue;
+        
+        if (count > MAX_CLIP_BOXES) {
+            boxes = region_extents(&g_visible[i]);
+            count = 1;
+        }
+        
+        for (int b = 0; b < count; b++) {
+            // Nothing of this box inside the area being repainted
+            if (boxes[b].x2 <= clip.x || boxes[b].x1 >= clip.x + clip.width ||
+                boxes[b].y2 <= clip.y || boxes[b].y1 >= clip.y + clip.height) {
+                continue;
+            }
+            
+            gfx_push_clip(boxes[b].x1, boxes[b].y1,
+                          boxes[b].x2 - boxes[b].x1, boxes[b].y2 - boxes[b].y1);
             window_draw(win);
+            gfx_pop_clip();
         }
     }
 }
@@ -380,37 +707,17 @@ void window_handle_event(window_t* win, event_t* event) {
     switch (event->type) {
         case EVENT_MOUSE_DOWN:
             if (event->mouse_button == MOUSE_BUTTON_LEFT) {
-                // Check close button
-                if (win->flags & WINDOW_FLAG_HAS_CLOSE) {
-                    int btn_x = win->x + win->width - BUTTON_CLOSE_X - 8;
-                    int btn_y = win->y + 4;
-                    if (event->mouse_x >= btn_x && event->mouse_x < btn_x + 16 &&
-                        event->mouse_y >= btn_y && event->mouse_y < btn_y + 16) {
+                // Title bar buttons
+                switch (chrome_button_at(win, event->mouse_x, event->mouse_y)) {
+                    case CHROME_CLOSE:
                         window_close(win);
                         return;
-                    }
-                }
-                
-                // Check minimize button
-                if (win->flags & WINDOW_FLAG_HAS_MINIMIZE) {
-                    int btn_x = win->x + win->width - BUTTON_CLOSE_X - 28;
-                    int btn_y = win->y + 4;
-                    if (event->mouse_x >= btn_x && event->mouse_x < btn_x + 16 &&
-                        event->mouse_y >= btn_y && event->mouse_y < btn_y + 16) {
+                    case CHROME_MINIMIZE:
                         window_minimize(win);
                         return;
-                    }
-                }
-                
-                // Check maximize button
-                if (win->flags & WINDOW_FLAG_HAS_MAXIMIZE) {
-                    int btn_x = win->x + win->width - BUTTON_CLOSE_X - 48;
-                    int btn_y = win->y + 4;
-                    if (event->mouse_x >= btn_x && event->mouse_x < btn_x + 16 &&
-                        event->mouse_y >= btn_y && event->mouse_y < btn_y + 16) {
+                    case CHROME_MAXIMIZE:
                         window_toggle_maximize(win);
                         return;
-                    }
                 }
                 
                 // Check if dragging title bar
@@ -433,7 +740,7 @@ void window_handle_event(window_t* win, event_t* event) {
                 window_bring_to_front(win);
             }
             break;
-            
+        
         case EVENT_MOUSE_MOVE:
             if (win->is_dragging) {
                 int new_x = event->mouse_x - win->drag_offset_x;
@@ -505,12 +812,12 @@ void window_handle_event(window_t* win, event_t* event) {
                 gui.needs_redraw = 1;
             }
             break;
-            
+        
         case EVENT_MOUSE_UP:
             win->is_dragging = 0;
             win->is_resizing = 0;
             break;
-            
+        
         default:
             break;
     }
@@ -0,0 +1,213 @@
+#include "bga.h"
+
+// DISPI ports and register indices
+#define VBE_DISPI_IOPORT_INDEX      0x01CE
+#define VBE_DISPI_IOPORT_DATA       0x01CF
+
+#define VBE_DISPI_INDEX_ID          0x0
+#define VBE_DISPI_INDEX_XRES        0x1
+#define VBE_DISPI_INDEX_YRES        0x2
+#define VBE_DISPI_INDEX_BPP         0x3
+#define VBE_DISPI_INDEX_ENABLE      0x4
+#define VBE_DISPI_INDEX_BANK        0x5
+#define VBE_DISPI_INDEX_VIRT_WIDTH  0x6
+#define VBE_DISPI_INDEX_VIRT_HEIGHT 0x7
+#define VBE_DISPI_INDEX_X_OFFSET    0x8
+#define VBE_DISPI_INDEX_Y_OFFSET    0x9
+#define VBE_DISPI_INDEX_VIDEO_MEMORY_64K 0xA
+
+// ID 0xB0C2 and later support 32bpp
+#define VBE_DISPI_ID_MIN            0xB0C2
+#define VBE_DISPI_ID_MAX            0xB0C5
+
+// ENABLE register bits
+#define VBE_DISPI_DISABLED          0x00
+#define VBE_DISPI_ENABLED           0x01
+#define VBE_DISPI_GETCAPS           0x02
+#define VBE_DISPI_LFB_ENABLED       0x40
+
+// Where the LFB lives when it cannot be found on PCI
+#define VBE_DISPI_LFB_PHYSICAL_ADDRESS 0xE0000000
+
+// PCI identity of the adapter
+#define BGA_PCI_VENDOR              0x1234
+#define BGA_PCI_DEVICE              0x1111
+
+#define PCI_CONFIG_ADDRESS          0xCF8
+#define PCI_CONFIG_DATA             0xCFC
+
+// VGA input status register: bit 3 is set during vertical retrace
+#define VGA_INPUT_STATUS_1          0x3DA
+#define VGA_VRETRACE                0x08
+
+// VGA DAC: write the start index, then 6-bit red, green, blue per entry
+#define VGA_DAC_WRITE_INDEX         0x3C8
+#define VGA_DAC_DATA                0x3C9
+
+// Standard modes tried, largest first, when a request does not fit
+static const int bga_modes[][2] = {
+    {1920, 1080}, {1680, 1050}, {1600, 900}, {1280, 1024},
+    {1280, 800}, {1280, 720}, {1024, 768}, {800, 600}, {640, 480}
+};
+#define BGA_MODE_COUNT (int)(sizeof(bga_modes) / sizeof(bga_modes[0]))
+
+static bga_mode_t current_mode = {0};
+
+// Port I/O helpers
+static inline void outw(uint16_t port, uint16_t val) {
+    __asm__ volatile ("outw %0, %1" : : "a"(val), "Nd"(port));
+}
+
+static inline uint16_t inw(uint16_t port) {
+    uint16_t ret;
+    __asm__ volatile ("inw %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+static inline void outl(uint16_t port, uint32_t val) {
+    __asm__ volatile ("outl %0, %1" : : "a"(val), "Nd"(port));
+}
+
+static inline uint32_t inl(uint16_t port) {
+    uint32_t ret;
+    __asm__ volatile ("inl %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+static inline void outb(uint16_t port, uint8_t val) {
+    __asm__ volatile ("outb %0, %1" : : "a"(val), "Nd"(port));
+}
+
+static inline uint8_t inb(uint16_t port) {
+    uint8_t ret;
+    __asm__ volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+static void bga_write(uint16_t index, uint16_t value) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    outw(VBE_DISPI_IOPORT_DATA, value);
+}
+
+static uint16_t bga_read(uint16_t index) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    return inw(VBE_DISPI_IOPORT_DATA);
+}
+
+static uint32_t pci_read(int bus, int dev, int func, int offset) {
+    outl(PCI_CONFIG_ADDRESS, 0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | (offset & 0xFC));
+    return inl(PCI_CONFIG_DATA);
+}
+
+// Find the LFB through BAR0 of the adapter's PCI function
+static uint32_t bga_find_lfb(void) {
+    for (int bus = 0; bus < 256; bus++) {
+        for (int dev = 0; dev < 32; dev++) {
+            uint32_t id = pci_read(bus, dev, 0, 0);
+            if (id == ((BGA_PCI_DEVICE << 16) | BGA_PCI_VENDOR)) {
+                uint32_t bar0 = pci_read(bus, dev, 0, 0x10);
+                if (bar0 & ~0xFu) {
+                    return bar0 & ~0xFu;
+                }
+            }
+        }
+    }
+    return VBE_DISPI_LFB_PHYSICAL_ADDRESS;
+}
+
+int bga_detect(void) {
+    uint16_t id = bga_read(VBE_DISPI_INDEX_ID);
+    return id >= VBE_DISPI_ID_MIN && id <= VBE_DISPI_ID_MAX;
+}
+
+// Program a mode and read back what the adapter actually accepted
+static int bga_try_mode(int width, int height, int bpp, int virt_height) {
+    bga_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+    bga_write(VBE_DISPI_INDEX_XRES, (uint16_t)width);
+    bga_write(VBE_DISPI_INDEX_YRES, (uint16_t)height);
+    bga_write(VBE_DISPI_INDEX_BPP, (uint16_t)bpp);
+    bga_write(VBE_DISPI_INDEX_VIRT_WIDTH, (uint16_t)width);
+    bga_write(VBE_DISPI_INDEX_VIRT_HEIGHT, (uint16_t)virt_height);
+    bga_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_ENABLED | VBE_DISPI_LFB_ENABLED);
+    bga_write(VBE_DISPI_INDEX_X_OFFSET, 0);
+    bga_write(VBE_DISPI_INDEX_Y_OFFSET, 0);
+    
+    return bga_read(VBE_DISPI_INDEX_XRES) == width &&
+           bga_read(VBE_DISPI_INDEX_YRES) == height &&
+           bga_read(VBE_DISPI_INDEX_BPP) == bpp;
+}
+
+int bga_set_mode(int width, int height, int bpp, bga_mode_t* mode) {
+    if (!bga_detect()) return -1;
+    if (bpp != 8 && bpp != 16 && bpp != 32) return -1;
+    uint32_t bytes = bpp / 8;
+    
+    // Adapter limits: GETCAPS makes the resolution registers report maxima
+    bga_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_GETCAPS);
+    int max_w = bga_read(VBE_DISPI_INDEX_XRES);
+    int max_h = bga_read(VBE_DISPI_INDEX_YRES);
+    bga_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+    
+    // Video memory in 64K units (0 on old adapters; assume QEMU's 16MB)
+    uint32_t vram = (uint32_t)bga_read(VBE_DISPI_INDEX_VIDEO_MEMORY_64K) * 65536;
+    if (vram == 0) vram = 16 * 1024 * 1024;
+    
+    // Step down until a mode fits the adapter with at least one page
+    int m = 0;
+    while (width > max_w || height > max_h || (uint32_t)width * height * bytes > vram) {
+        while (m < BGA_MODE_COUNT && (bga_modes[m][0] > width || bga_modes[m][1] > height ||
+               bga_modes[m][0] > max_w || bga_modes[m][1] > max_h ||
+               (uint32_t)bga_modes[m][0] * bga_modes[m][1] * bytes > vram)) {
+            m++;
+        }
+        if (m == BGA_MODE_COUNT) return -1;
+        width = bga_modes[m][0];
+        height = bga_modes[m][1];
+    }
+    
+    // Two stacked pages for flipping when they fit
+    int pages = ((uint32_t)width * height * bytes * 2 <= vram) ? 2 : 1;
+    if (!bga_try_mode(width, height, bpp, height * pages)) {
+        bga_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+        return -1;
+    }
+    if (pages == 2 && bga_read(VBE_DISPI_INDEX_VIRT_HEIGHT) < height * 2) {
+        pages = 1;
+    }
+    
+    current_mode.base = (uint32_t*)bga_find_lfb();
+    current_mode.width = width;
+    current_mode.height = height;
+    current_mode.pitch = bga_read(VBE_DISPI_INDEX_VIRT_WIDTH) * bytes;
+    current_mode.bpp = bpp;
+    current_mode.pages = pages;
+    *mode = current_mode;
+    return 0;
+}
+
+void bga_set_palette(int index, uint8_t r, uint8_t g, uint8_t b) {
+    outb(VGA_DAC_WRITE_INDEX, (uint8_t)index);
+    outb(VGA_DAC_DATA, r >> 2);
+    outb(VGA_DAC_DATA, g >> 2);
+    outb(VGA_DAC_DATA, b >> 2);
+}
+
+void bga_disable(void) {
+    bga_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+    current_mode.pages = 0;
+}
+
+void* bga_page(int page) {
+    return (uint8_t*)current_mode.base + page * current_mode.height * current_mode.pitch;
+}
+
+// Switch pages during vertical retrace so the scanout never shows half of
+// each. The waits are bounded in case retrace is not emulated.
+void bga_show_page(int page) {
+    int spins = 1000000;
+    while ((inb(VGA_INPUT_STATUS_1) & VGA_VRETRACE) && --spins > 0);
+    spins = 1000000;
+    while (!(inb(VGA_INPUT_STATUS_1) & VGA_VRETRACE) && --spins > 0);
+    
+    bga_write(VBE_DISPI_INDEX_Y_OFFSET, (uint16_t)(page * current_mode.height));
+}
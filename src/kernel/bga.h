@@ -0,0 +1,48 @@
+#ifndef BGA_H
+#define BGA_H
+
+#include <stdint.h>
+
+// Bochs Graphics Adapter: the display device of Bochs and QEMU -vga std,
+// programmed directly through the VBE DISPI index/data ports, so no BIOS
+// or boot loader mode switch is needed.
+
+// Mode used when nothing else asks for one
+#ifndef BGA_DEFAULT_WIDTH
+#define BGA_DEFAULT_WIDTH  1024
+#endif
+#ifndef BGA_DEFAULT_HEIGHT
+#define BGA_DEFAULT_HEIGHT 768
+#endif
+#ifndef BGA_DEFAULT_BPP
+#define BGA_DEFAULT_BPP    32
+#endif
+
+typedef struct {
+    uint32_t* base;     // Linear framebuffer, page 0
+    int width;
+    int height;
+    int pitch;          // Bytes per row
+    int bpp;            // 8, 16 or 32
+    int pages;          // Screens stacked in the virtual framebuffer (1 or 2)
+} bga_mode_t;
+
+// Returns 1 if a usable adapter answers on the DISPI ports
+int bga_detect(void);
+
+// Set a mode of at most width x height at bpp (8, 16 or 32), with two
+// pages when video memory allows. Steps down to the largest standard mode
+// the adapter can do if the request is too big. Returns 0 on success.
+int bga_set_mode(int width, int height, int bpp, bga_mode_t* mode);
+
+// Load one 8bpp palette entry (8-bit components)
+void bga_set_palette(int index, uint8_t r, uint8_t g, uint8_t b);
+
+// Return the display to legacy VGA (text) mode
+void bga_disable(void);
+
+// Page flipping: start of a page, and make a page the one scanned out
+void* bga_page(int page);
+void bga_show_page(int page);
+
+#endif // BGA_H
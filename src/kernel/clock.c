@@ -0,0 +1,85 @@
+#include "clock.h"
+
+// PIT: 1.193182 MHz input clock; channel 2 is gated and read through
+// port 0x61 (bit 0 gate, bit 1 speaker enable, bit 5 channel 2 output)
+#define PIT_HZ              1193182
+#define PIT_CHANNEL2        0x42
+#define PIT_COMMAND         0x43
+#define PIT_GATE_PORT       0x61
+#define PIT_GATE            0x01
+#define PIT_SPEAKER         0x02
+#define PIT_OUT2            0x20
+
+// Calibration interval
+#define CLOCK_CALIBRATE_MS  10
+
+static uint32_t tsc_per_us = 0;
+static uint64_t last_tsc = 0;
+static uint32_t now_us = 0;
+
+static inline void outb(uint16_t port, uint8_t val) {
+    __asm__ volatile ("outb %0, %1" : : "a"(val), "Nd"(port));
+}
+
+static inline uint8_t inb(uint16_t port) {
+    uint8_t ret;
+    __asm__ volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// n / d for a quotient that fits 32 bits, with divl (no libgcc here)
+static inline uint32_t div64_32(uint64_t n, uint32_t d, uint32_t* rem) {
+    uint32_t q, r;
+    __asm__ ("divl %4" : "=a"(q), "=d"(r) : "a"((uint32_t)n), "d"((uint32_t)(n >> 32)), "rm"(d));
+    *rem = r;
+    return q;
+}
+
+int clock_init(void) {
+    // Channel 2, mode 0 (output goes high at terminal count), one shot
+    uint16_t count = PIT_HZ / 1000 * CLOCK_CALIBRATE_MS;
+    uint8_t gate = inb(PIT_GATE_PORT) & ~(PIT_GATE | PIT_SPEAKER);
+    outb(PIT_GATE_PORT, gate);
+    outb(PIT_COMMAND, 0xB0);
+    outb(PIT_CHANNEL2, count & 0xFF);
+    outb(PIT_CHANNEL2, count >> 8);
+    
+    // Count TSC ticks until the PIT output rises; bounded in case the
+    // channel is not emulated
+    outb(PIT_GATE_PORT, gate | PIT_GATE);
+    uint64_t start = rdtsc();
+    int spins = 100000000;
+    while (!(inb(PIT_GATE_PORT) & PIT_OUT2) && --spins > 0);
+    uint64_t end = rdtsc();
+    outb(PIT_GATE_PORT, gate);
+    if (spins == 0) return 0;
+    
+    tsc_per_us = (uint32_t)(end - start) / (CLOCK_CALIBRATE_MS * 1000);
+    if (tsc_per_us == 0) tsc_per_us = 1;
+    last_tsc = rdtsc();
+    now_us = 0;
+    return 1;
+}
+
+uint32_t clock_us(void) {
+    if (!tsc_per_us) return 0;
+    
+    // Whole microseconds since the last reading; the remainder stays in
+    // last_tsc so no time is lost between readings
+    uint64_t tsc = rdtsc();
+    uint64_t delta = tsc - last_tsc;
+    if ((uint32_t)(delta >> 32) >= tsc_per_us) {
+        delta = ((uint64_t)tsc_per_us << 32) - 1;
+        last_tsc = tsc - delta;
+    }
+    uint32_t rem;
+    now_us += div64_32(delta, tsc_per_us, &rem);
+    last_tsc = tsc - rem;
+    return now_us;
+}
@@ -0,0 +1,18 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+// Microsecond clock on the CPU time-stamp counter, whose rate is measured
+// once against PIT channel 2 (the speaker channel, which is free and can be
+// polled with interrupts off).
+
+// Calibrate the clock. Returns 0 if the PIT never signalled, in which case
+// clock_us() stays at 0.
+int clock_init(void);
+
+// Microseconds since clock_init(); wraps after about 71 minutes, so only
+// differences of readings are meaningful
+uint32_t clock_us(void);
+
+#endif // CLOCK_H
@@ -0,0 +1,168 @@
+#include "irq.h"
+
+// 8259 PIC pair
+#define PIC1_COMMAND    0x20
+#define PIC1_DATA       0x21
+#define PIC2_COMMAND    0xA0
+#define PIC2_DATA       0xA1
+#define PIC_EOI         0x20
+#define PIC_READ_ISR    0x0B
+#define IRQ_VECTOR_BASE 32
+
+// PIT channel 0, whose output drives IRQ 0
+#define PIT_HZ          1193182
+#define PIT_CHANNEL0    0x40
+#define PIT_COMMAND     0x43
+
+// IDT entry (32-bit interrupt gate)
+typedef struct {
+    uint16_t offset_low;
+    uint16_t selector;
+    uint8_t zero;
+    uint8_t type_attr;
+    uint16_t offset_high;
+} __attribute__((packed)) idt_entry_t;
+
+typedef struct {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) idt_pointer_t;
+
+// Exceptions (vectors 0-31) are left not-present, as before
+static idt_entry_t idt[IRQ_VECTOR_BASE + 16];
+static uint32_t irq_counts[16];
+
+static inline void outb(uint16_t port, uint8_t val) {
+    __asm__ volatile ("outb %0, %1" : : "a"(val), "Nd"(port));
+}
+
+static inline uint8_t inb(uint16_t port) {
+    uint8_t ret;
+    __asm__ volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+// Give the PIC time to settle between initialisation words
+static inline void io_wait(void) {
+    outb(0x80, 0);
+}
+
+// Called from the entry stubs below with the line number
+__attribute__((used)) static void irq_dispatch(uint32_t irq) {
+    // IRQ 7 and 15 fire spuriously when a request is withdrawn; the ISR bit
+    // is clear then and the (slave) PIC must not see an EOI for it
+    if (irq == 7 || irq == 15) {
+        uint16_t port = (irq == 7) ? PIC1_COMMAND : PIC2_COMMAND;
+        outb(port, PIC_READ_ISR);
+        if (!(inb(port) & 0x80)) {
+            if (irq == 15) outb(PIC1_COMMAND, PIC_EOI);
+            return;
+        }
+    }
+    
+    irq_counts[irq]++;
+    if (irq >= 8) outb(PIC2_COMMAND, PIC_EOI);
+    outb(PIC1_COMMAND, PIC_EOI);
+}
+
+// Entry stubs: push the line number, save the general registers and call
+// irq_dispatch on a 16-byte aligned stack
+#define IRQ_STUB(n) \
+    "irq_stub" #n ":\n" \
+    "    pushl $" #n "\n" \
+    "    jmp irq_common\n"
+
+__asm__ (
+    ".pushsection .text\n"
+    "irq_common:\n"
+    "    pushal\n"
+    "    cld\n"
+    "    movl %esp, %ebp\n"
+    "    movl 32(%ebp), %eax\n"
+    "    andl $-16, %esp\n"
+    "    subl $12, %esp\n"
+    "    pushl %eax\n"
+    "    call irq_dispatch\n"
+    "    movl %ebp, %esp\n"
+    "    popal\n"
+    "    addl $4, %esp\n"
+    "    iret\n"
+    IRQ_STUB(0) IRQ_STUB(1) IRQ_STUB(2) IRQ_STUB(3)
+    IRQ_STUB(4) IRQ_STUB(5) IRQ_STUB(6) IRQ_STUB(7)
+    IRQ_STUB(8) IRQ_STUB(9) IRQ_STUB(10) IRQ_STUB(11)
+    IRQ_STUB(12) IRQ_STUB(13) IRQ_STUB(14) IRQ_STUB(15)
+    ".popsection\n"
+    ".pushsection .rodata\n"
+    ".align 4\n"
+    "irq_stubs:\n"
+    "    .long irq_stub0, irq_stub1, irq_stub2, irq_stub3\n"
+    "    .long irq_stub4, irq_stub5, irq_stub6, irq_stub7\n"
+    "    .long irq_stub8, irq_stub9, irq_stub10, irq_stub11\n"
+    "    .long irq_stub12, irq_stub13, irq_stub14, irq_stub15\n"
+    ".popsection\n"
+);
+
+extern const uint32_t irq_stubs[16];
+
+void irq_init(void) {
+    uint16_t cs;
+    __asm__ volatile ("mov %%cs, %0" : "=r"(cs));
+    
+    for (int i = 0; i < 16; i++) {
+        idt_entry_t* e = &idt[IRQ_VECTOR_BASE + i];
+        e->offset_low = irq_stubs[i] & 0xFFFF;
+        e->offset_high = irq_stubs[i] >> 16;
+        e->selector = cs;
+        e->zero = 0;
+        e->type_attr = 0x8E;    // present, ring 0, 32-bit interrupt gate
+        irq_counts[i] = 0;
+    }
+    
+    idt_pointer_t ptr = {sizeof(idt) - 1, (uint32_t)idt};
+    __asm__ volatile ("lidt %0" : : "m"(ptr));
+    
+    // Remap: master to vectors 32-39, slave to 40-47, slave on line 2
+    outb(PIC1_COMMAND, 0x11); io_wait();
+    outb(PIC2_COMMAND, 0x11); io_wait();
+    outb(PIC1_DATA, IRQ_VECTOR_BASE); io_wait();
+    outb(PIC2_DATA, IRQ_VECTOR_BASE + 8); io_wait();
+    outb(PIC1_DATA, 1 << IRQ_CASCADE); io_wait();
+    outb(PIC2_DATA, IRQ_CASCADE); io_wait();
+    outb(PIC1_DATA, 0x01); io_wait();
+    outb(PIC2_DATA, 0x01); io_wait();
+    
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+}
+
+void irq_unmask(int irq) {
+    if (irq < 0 || irq > 15) return;
+    if (irq >= 8) {
+        outb(PIC2_DATA, inb(PIC2_DATA) & ~(1 << (irq - 8)));
+        irq = IRQ_CASCADE;
+    }
+    outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << irq));
+}
+
+void irq_timer_start(uint32_t hz) {
+    uint32_t divisor = PIT_HZ / hz;
+    if (divisor > 0xFFFF) divisor = 0xFFFF;
+    if (divisor < 1) divisor = 1;
+    
+    // Channel 0, low then high byte, mode 2 (rate generator)
+    outb(PIT_COMMAND, 0x34);
+    outb(PIT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_CHANNEL0, divisor >> 8);
+    irq_unmask(IRQ_TIMER);
+}
+
+void irq_wait(void) {
+    // sti takes effect after the next instruction, so an interrupt that is
+    // already pending wakes the hlt instead of slipping in before it
+    __asm__ volatile ("sti; hlt; cli" : : : "memory");
+}
+
+uint32_t irq_count(int irq) {
+    if (irq < 0 || irq > 15) return 0;
+    return irq_counts[irq];
+}
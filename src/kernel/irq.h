@@ -0,0 +1,29 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdint.h>
+
+// Hardware interrupts through the legacy 8259 PICs, remapped to vectors
+// 32-47. Interrupts stay disabled except inside irq_wait(), so the handlers
+// only ever interrupt a halted CPU and need no locking.
+#define IRQ_TIMER       0
+#define IRQ_KEYBOARD    1
+#define IRQ_CASCADE     2
+#define IRQ_MOUSE       12
+
+// Install the IDT and remap the PICs with every line masked
+void irq_init(void);
+
+// Let an interrupt line through (IRQ 8-15 also open the cascade)
+void irq_unmask(int irq);
+
+// Run PIT channel 0 as a periodic tick on IRQ 0
+void irq_timer_start(uint32_t hz);
+
+// Sleep until the next interrupt has been handled
+void irq_wait(void);
+
+// Interrupts taken on a line since irq_init()
+uint32_t irq_count(int irq);
+
+#endif // IRQ_H
@@ -3,12 +3,20 @@
 
 // Include our libc compatibility layer
 #include "../libc_compat.h"
+#include "bga.h"
+#include "../graphics/gfx.h"
+#include "clock.h"
+#include "irq.h"
 
 // Forward declaration of GUI functions
 extern void gui_init(int width, int height, void* fb, int pitch);
 extern void gui_run();
 extern void gui_shutdown();
 extern void gui_create_desktop();
+extern void gui_set_clock(uint32_t (*clock)(void));
+extern void gui_set_idle(void (*idle)(void));
+extern void ps2_enable_irqs();
+extern void hud_set_irq_source(uint32_t (*count)(int irq));
 
 // Graphics globals (defined in gfx.c)
 extern uint32_t* framebuffer;
@@ -37,6 +45,9 @@ extern void clear_screen(uint32_t color);
 #define COLOR_YELLOW    0xFFFFFF00
 #define COLOR_MAGENTA   0xFFFF00FF
 
+// Timer tick that wakes the idle GUI loop; fine enough to hit frame slots
+#define IDLE_TICK_HZ    1000
+
 // VGA text mode buffer
 static volatile uint16_t* vga_buf = (volatile uint16_t*)0xB8000;
 
@@ -104,9 +115,7 @@ static void vga_write_text(const char* str, int row, uint8_t color) {
 }
 
 void kernel_main(uint32_t mb_info, uint32_t mb_magic) {
-    // Note: boot.s pushes EBX (info pointer) first, so mb_info is actually EBX
-    // And EAX contains the magic. With cdecl, first arg is on stack = EBX
-    // mb_magic = EAX (passed in register)
+    // boot.s passes the info pointer (EBX) and the magic (EAX)
     
     // Initialize heap first
     heap_init();
@@ -119,7 +128,6 @@ void kernel_main(uint32_t mb_info, uint32_t mb_magic) {
     vga_clear();
     vga_write_text("FLUX-OS", 0, 0x0A);
     
-    // mb_magic is in EAX, mb_info is the pushed EBX value
     serial_write("Magic (EAX): ");
     serial_write_hex(mb_magic);
     serial_write("\n");
@@ -127,35 +135,34 @@ void kernel_main(uint32_t mb_info, uint32_t mb_magic) {
     serial_write_hex(mb_info);
     serial_write("\n");
     
-    // The multiboot magic should be in EAX, but we need to get it from the register
-    uint32_t magic;
-    __asm__ volatile ("mov %%eax, %0" : "=r"(magic));
+    uint32_t fb_addr = 0;
+    uint32_t fb_width = 0;
+    uint32_t fb_height = 0;
+    uint32_t fb_pitch = 0;
+    uint32_t fb_bpp = 32;
+    int graphics_mode = 0;
     
-    serial_write("Real magic: ");
-    serial_write_hex(magic);
-    serial_write("\n");
+    // Mode to ask the display adapter for; a boot loader framebuffer
+    // request overrides the default
+    int want_width = BGA_DEFAULT_WIDTH;
+    int want_height = BGA_DEFAULT_HEIGHT;
+    gfx_format_t format = GFX_FORMAT_XRGB8888;
     
-    if (magic != 0x2BADB002) {
+    if (mb_magic == 0x2BADB002) {
+        vga_write_text("Multiboot OK", 2, 0x0A);
+        serial_write("Multiboot OK\n");
+    } else {
         vga_write_text("No Multiboot!", 2, 0x0C);
-        serial_write("ERROR: No Multiboot!\n");
-        goto text_mode;
+        serial_write("No Multiboot, skipping boot info\n");
+        mb_info = 0;
     }
     
-    vga_write_text("Multiboot OK", 2, 0x0A);
-    serial_write("Multiboot OK\n");
-    
     // Parse multiboot info safely
-    uint32_t flags = *(uint32_t*)mb_info;
+    uint32_t flags = mb_info ? *(uint32_t*)mb_info : 0;
     serial_write("Flags: ");
     serial_write_hex(flags);
     serial_write("\n");
     
-    uint32_t fb_addr = 0;
-    uint32_t fb_width = 0;
-    uint32_t fb_height = 0;
-    uint32_t fb_pitch = 0;
-    int graphics_mode = 0;
-    
     // Check for framebuffer info (bit 12)
     if ((flags >> 12) & 1) {
         vga_write_text("Checking FB info...", 3, 0x0B);
@@ -167,6 +174,8 @@ void kernel_main(uint32_t mb_info, uint32_t mb_magic) {
         uint32_t fb_h = *(uint32_t*)(mb_info + 64);
         uint32_t fb_p = *(uint32_t*)(mb_info + 68);
         uint32_t fb_a = *(uint32_t*)(mb_info + 72);
+        uint8_t fb_b = *(uint8_t*)(mb_info + 76);
+        uint8_t fb_red_pos = *(uint8_t*)(mb_info + 78);
         
         serial_write("FB type: ");
         serial_write_hex(fb_type);
@@ -180,33 +189,66 @@ void kernel_main(uint32_t mb_info, uint32_t mb_magic) {
             fb_width = fb_w;
             fb_height = fb_h;
             fb_pitch = fb_p;
+            fb_bpp = fb_b;
             graphics_mode = 1;
+            want_width = fb_w;
+            want_height = fb_h;
+            
+            // Direct color layout, from the red field position
+            if (fb_b == 16) {
+                format = GFX_FORMAT_RGB565;
+            } else if (fb_b == 32 && fb_red_pos == 0) {
+                format = GFX_FORMAT_XBGR8888;
+            } else if (fb_b != 32) {
+                serial_write("Unsupported FB depth\n");
+                graphics_mode = 0;
+            }
             
             vga_write_text("FB: OK", 4, 0x0A);
-            serial_write("Using Multiboot FB\n");
+            serial_write("Multiboot FB available\n");
         }
     }
     
-    // If no framebuffer, try VGA 13h
-    if (!graphics_mode) {
-        vga_write_text("Trying VGA 13h...", 5, 0x0B);
-        serial_write("Trying VGA 13h...\n");
-        
-        // Set VGA mode 13h
-        __asm__ volatile (
-            "mov $0x13, %%ax\n"
-            "int $0x10\n"
-            : : : "ax"
-        );
+    // Prefer programming the Bochs/QEMU adapter directly: it needs no boot
+    // time mode switch and supports page flipping
+    bga_mode_t bga = {0};
+    if (bga_detect()) {
+        vga_write_text("Setting BGA mode...", 5, 0x0B);
+        serial_write("BGA detected\n");
         
-        fb_addr = 0xA0000;
-        fb_width = 320;
-        fb_height = 200;
-        fb_pitch = 320;
-        graphics_mode = 1;
-        
-        vga_write_text("VGA 13h active", 6, 0x0A);
-        serial_write("VGA 13h active\n");
+        if (bga_set_mode(want_width, want_height, BGA_DEFAULT_BPP, &bga) == 0) {
+            fb_addr = (uint32_t)bga.base;
+            fb_width = bga.width;
+            fb_height = bga.height;
+            fb_pitch = bga.pitch;
+            fb_bpp = bga.bpp;
+            graphics_mode = 2;
+            
+            if (bga.bpp == 16) {
+                format = GFX_FORMAT_RGB565;
+            } else if (bga.bpp == 8) {
+                format = GFX_FORMAT_PAL8;
+                for (int i = 0; i < 256; i++) {
+                    uint32_t c = gfx_palette_color(i);
+                    bga_set_palette(i, (c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+                }
+            } else {
+                format = GFX_FORMAT_XRGB8888;
+            }
+            
+            vga_write_text("BGA active", 6, 0x0A);
+            serial_write("BGA pages: ");
+            serial_write_hex(bga.pages);
+            serial_write("\n");
+        } else {
+            serial_write("BGA mode set failed\n");
+        }
+    }
+    
+    if (!graphics_mode) {
+        vga_write_text("No graphics mode", 5, 0x0C);
+        serial_write("ERROR: No framebuffer and no BGA\n");
+        goto text_mode;
     }
     
     // Set global graphics state
@@ -231,13 +273,40 @@ void kernel_main(uint32_t mb_info, uint32_t mb_magic) {
     serial_write("Graphics mode: ");
     serial_write_hex(graphics_mode);
     serial_write("\n");
+    serial_write("Bits per pixel: ");
+    serial_write_hex(fb_bpp);
+    serial_write("\n");
     
     vga_write_text("Initializing GUI...", 10, 0x0A);
     serial_write("Initializing GUI...\n");
     
-    // Initialize GUI
+    // Initialize GUI, drawing in 32bpp and converting on present
+    gfx_set_format(format);
     gui_init(screen_width, screen_height, framebuffer, pitch);
     
+    // Render into the hidden page and flip on present
+    if (graphics_mode == 2 && bga.pages > 1) {
+        gfx_enable_page_flip(bga_page(1), bga_show_page);
+    }
+    
+    // Full redraws mostly repaint identical pixels; only send tiles that changed
+    gfx_set_tile_hashing(1);
+    
+    // Pace frames off the TSC; without it every loop iteration renders
+    if (clock_init()) {
+        gui_set_clock(clock_us);
+    }
+    
+    // Sleep between passes of the GUI loop; the timer tick and keyboard and
+    // mouse interrupts wake it
+    irq_init();
+    irq_timer_start(IDLE_TICK_HZ);
+    ps2_enable_irqs();
+    irq_unmask(IRQ_KEYBOARD);
+    irq_unmask(IRQ_MOUSE);
+    gui_set_idle(irq_wait);
+    hud_set_irq_source(irq_count);
+    
     serial_write("GUI init returned, checking state...\n");
     
     gui_create_desktop();
@@ -248,6 +317,11 @@ void kernel_main(uint32_t mb_info, uint32_t mb_magic) {
     // Run GUI
     gui_run();
     
+    // Back to VGA text for the messages below
+    if (graphics_mode == 2) {
+        bga_disable();
+    }
+
 text_mode:
     // Fallback to text mode
     vga_clear();
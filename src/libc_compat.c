@@ -2,10 +2,13 @@
 #include <stddef.h>
 #include <stdarg.h>
 
-// Simple memory allocator for the kernel
-#define HEAP_START 0xC0000000
+// Simple memory allocator for the kernel. The heap is a static buffer so
+// it lives in RAM the loader has placed (and zeroed) with the kernel.
 #define HEAP_SIZE  (16 * 1024 * 1024)  // 16MB heap
 
+// Smallest remainder worth splitting off a free block
+#define HEAP_MIN_SPLIT 16
+
 // Heap management structure
 typedef struct header {
     uint32_t size;
@@ -13,16 +16,24 @@ typedef struct header {
     int is_allocated;
 } header_t;
 
-static header_t* heap_head = (header_t*)HEAP_START;
+static uint8_t heap_memory[HEAP_SIZE] __attribute__((aligned(16)));
+static header_t* heap_head = (header_t*)heap_memory;
 static uint32_t heap_used = 0;
 
 // Initialize the heap
 void heap_init() {
+    heap_head = (header_t*)heap_memory;
+    heap_used = 0;
     heap_head->size = HEAP_SIZE - sizeof(header_t);
     heap_head->next = 0;
     heap_head->is_allocated = 0;
 }
 
+void heap_stats(size_t* used, size_t* total) {
+    if (used) *used = heap_used;
+    if (total) *total = HEAP_SIZE;
+}
+
 // Simple malloc implementation
 void* malloc(size_t size) {
     if (size == 0) return 0;
@@ -30,20 +41,37 @@ void* malloc(size_t size) {
     // Align to 4 bytes
     size = (size + 3) & ~0x03;
     
-    header_t* prev = 0;
     header_t* curr = heap_head;
     
     while (curr) {
+        // Merge free neighbours that free() could not reach
+        if (!curr->is_allocated) {
+            while (curr->next && !curr->next->is_allocated) {
+                curr->size += sizeof(header_t) + curr->next->size;
+                curr->next = curr->next->next;
+            }
+        }
+        
         // Check if this block is free and large enough
         if (!curr->is_allocated && curr->size >= size) {
+            // Split off the rest of the block for later allocations
+            if (curr->size >= size + sizeof(header_t) + HEAP_MIN_SPLIT) {
+                header_t* rest = (header_t*)((uint8_t*)curr + sizeof(header_t) + size);
+                rest->size = curr->size - size - sizeof(header_t);
+                rest->next = curr->next;
+                rest->is_allocated = 0;
+                curr->size = size;
+                curr->next = rest;
+            }
+            
             // Allocate this block
             curr->is_allocated = 1;
+            heap_used += curr->size;
             
             // Return pointer after header
             return (void*)((uint8_t*)curr + sizeof(header_t));
         }
         
-        prev = curr;
         curr = curr->next;
     }
     
@@ -60,6 +88,7 @@ void free(void* ptr) {
     
     // Mark as free
     header->is_allocated = 0;
+    heap_used -= header->size;
     
     // Simple coalescing: merge with next block if it's also free
     if (header->next && !header->next->is_allocated) {
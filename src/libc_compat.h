@@ -26,5 +26,8 @@ void vga_set_position(int r, int c);
 // Heap initialization
 void heap_init();
 
+// Bytes handed out by malloc() and the heap's size
+void heap_stats(size_t* used, size_t* total);
+
 #endif // LIBC_COMPAT_H
 
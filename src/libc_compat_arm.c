@@ -10,7 +10,10 @@
 /* Simple heap allocator for ARM */
 /* Use a fixed buffer in DRAM - will be placed by linker */
 #define HEAP_START 0x10000000  /* 256MB - in RAM region */
-#define HEAP_SIZE  (8 * 1024 * 1024)  /* 8MB heap */
+#define HEAP_SIZE  (32 * 1024 * 1024)  /* 32MB heap: window surfaces live here */
+
+/* Smallest remainder worth splitting off a free block */
+#define HEAP_MIN_SPLIT 16
 
 /* Heap management structure */
 typedef struct header {
@@ -22,6 +25,7 @@ typedef struct header {
 static char heap_memory[HEAP_SIZE] __attribute__((aligned(8)));
 static header_t* heap_head = (header_t*)heap_memory;
 static int heap_initialized = 0;
+static size_t heap_used = 0;
 
 /* Initialize the heap */
 void heap_init() {
@@ -34,6 +38,11 @@ void heap_init() {
     heap_initialized = 1;
 }
 
+void heap_stats(size_t* used, size_t* total) {
+    if (used) *used = heap_used;
+    if (total) *total = HEAP_SIZE;
+}
+
 /* Simple malloc implementation */
 void* malloc(size_t size) {
     if (!heap_initialized) heap_init();
@@ -42,20 +51,37 @@ void* malloc(size_t size) {
     /* Align to 8 bytes */
     size = (size + 7) & ~0x07;
     
-    header_t* prev = 0;
     header_t* curr = heap_head;
     
     while (curr) {
+        /* Merge free neighbours that free() could not reach */
+        if (!curr->is_allocated) {
+            while (curr->next && !curr->next->is_allocated) {
+                curr->size += sizeof(header_t) + curr->next->size;
+                curr->next = curr->next->next;
+            }
+        }
+        
         /* Check if this block is free and large enough */
         if (!curr->is_allocated && curr->size >= size) {
+            /* Split off the rest of the block for later allocations */
+            if (curr->size >= size + sizeof(header_t) + HEAP_MIN_SPLIT) {
+                header_t* rest = (header_t*)((char*)curr + sizeof(header_t) + size);
+                rest->size = curr->size - size - sizeof(header_t);
+                rest->next = curr->next;
+                rest->is_allocated = 0;
+                curr->size = size;
+                curr->next = rest;
+            }
+            
             /* Allocate this block */
             curr->is_allocated = 1;
+            heap_used += curr->size;
             
             /* Return pointer after header */
             return (void*)((char*)curr + sizeof(header_t));
         }
         
-        prev = curr;
         curr = curr->next;
     }
     
@@ -73,6 +99,7 @@ void free(void* ptr) {
     
     /* Mark as free */
     header->is_allocated = 0;
+    heap_used -= header->size;
     
     /* Simple coalescing: merge with next block if it's also free */
     if (header->next && !header->next->is_allocated) {
@@ -0,0 +1,279 @@
+#!/usr/bin/env python3
+"""Convert bitmap fonts (BDF, PSF1, PSF2) into packed C tables for gfx.
+
+Usage: fontgen.py -o out.c [--range FIRST-LAST] NAME=FONT [NAME=FONT ...]
+
+Each FONT becomes a `const gfx_font_t NAME` (see src/graphics/font.h), so one
+output file can hold several fonts or several pixel sizes of one family.
+Glyph bitmaps are cropped to their inked pixels and stored back to back, one
+row after another, with bit n of each byte being column 8k + n. The index is
+dense over FIRST..LAST (default 32-126); codepoints the font lacks map to
+glyph 0, an empty glyph one cell wide.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+
+class Glyph:
+    def __init__(self, codepoint, advance, left, top, rows, width):
+        self.codepoint = codepoint
+        self.advance = advance
+        self.left = left          # first column, relative to the pen
+        self.top = top            # first row, relative to the cell top
+        self.rows = rows          # ints, bit n = column left + n
+        self.width = width
+
+
+class Font:
+    def __init__(self, cell_width, cell_height, ascent):
+        self.cell_width = cell_width
+        self.cell_height = cell_height
+        self.ascent = ascent
+        self.glyphs = {}
+
+
+def fail(message):
+    sys.exit("fontgen: " + message)
+
+
+def msb_row(data, width):
+    """MSB-first bitmap row bytes -> int with bit n = column n."""
+    value = int.from_bytes(data, "big") if data else 0
+    total = len(data) * 8
+    return sum(1 << x for x in range(width) if value >> (total - 1 - x) & 1)
+
+
+def load_bdf(path):
+    with open(path, encoding="latin-1") as f:
+        lines = [line.split() for line in f]
+
+    props = {}
+    bbox = None
+    glyphs = []
+    i = 0
+    while i < len(lines):
+        words = lines[i]
+        i += 1
+        if not words:
+            continue
+        if words[0] == "FONTBOUNDINGBOX":
+            bbox = [int(w) for w in words[1:5]]
+        elif words[0] in ("FONT_ASCENT", "FONT_DESCENT"):
+            props[words[0]] = int(words[1])
+        elif words[0] == "STARTCHAR":
+            glyph = {"encoding": -1, "dwidth": None, "bbx": None, "bitmap": []}
+            while i < len(lines) and lines[i][:1] != ["ENDCHAR"]:
+                words = lines[i]
+                i += 1
+                if words[:1] == ["ENCODING"]:
+                    glyph["encoding"] = int(words[-1] if len(words) > 2 and words[1] == "-1" else words[1])
+                elif words[:1] == ["DWIDTH"]:
+                    glyph["dwidth"] = int(words[1])
+                elif words[:1] == ["BBX"]:
+                    glyph["bbx"] = [int(w) for w in words[1:5]]
+                elif words[:1] == ["BITMAP"]:
+                    while i < len(lines) and lines[i][:1] != ["ENDCHAR"]:
+                        glyph["bitmap"].append(lines[i][0])
+                        i += 1
+            i += 1
+            glyphs.append(glyph)
+
+    if bbox is None:
+        fail(path + ": no FONTBOUNDINGBOX")
+    ascent = props.get("FONT_ASCENT", bbox[1] + bbox[3])
+    descent = props.get("FONT_DESCENT", -bbox[3])
+    cell_width = max([g["dwidth"] or 0 for g in glyphs] + [bbox[0]])
+    font = Font(cell_width, ascent + descent, ascent)
+
+    for g in glyphs:
+        if g["encoding"] < 0:
+            continue
+        w, h, xoff, yoff = g["bbx"] or bbox
+        rows = [msb_row(bytes.fromhex(hexrow), w) for hexrow in g["bitmap"][:h]]
+        font.glyphs[g["encoding"]] = Glyph(g["encoding"], g["dwidth"] or cell_width,
+                                           xoff, ascent - (yoff + h), rows, w)
+    return font
+
+
+def load_psf(path, data):
+    if data[:2] == b"\x36\x04":
+        mode, charsize = data[2], data[3]
+        count = 512 if mode & 0x01 else 256
+        width, height, header = 8, charsize, 4
+        has_table = mode & 0x06
+    else:
+        (header, flags, count, charsize, height, width) = struct.unpack_from("<6I", data, 8)
+        has_table = flags & 0x01
+
+    row_bytes = (width + 7) // 8
+    font = Font(width, height, height)
+    bitmaps = []
+    for n in range(count):
+        base = header + n * charsize
+        bitmaps.append([msb_row(data[base + r * row_bytes:base + (r + 1) * row_bytes], width)
+                        for r in range(height)])
+
+    # Codepoints per glyph from the Unicode table, or glyph n = codepoint n
+    codepoints = [[n] for n in range(count)]
+    if has_table:
+        pos = header + count * charsize
+        codepoints = [[] for _ in range(count)]
+        for n in range(count):
+            if data[:2] == b"\x36\x04":
+                in_sequence = False
+                while pos + 1 < len(data):
+                    (value,) = struct.unpack_from("<H", data, pos)
+                    pos += 2
+                    if value == 0xFFFF:
+                        break
+                    if value == 0xFFFE:
+                        in_sequence = True
+                    elif not in_sequence:
+                        codepoints[n].append(value)
+            else:
+                end = data.index(b"\xff", pos)
+                entry = data[pos:end].split(b"\xfe")[0]
+                codepoints[n].extend(ord(c) for c in entry.decode("utf-8"))
+                pos = end + 1
+
+    for n, cps in enumerate(codepoints):
+        for cp in cps:
+            if cp not in font.glyphs:
+                font.glyphs[cp] = Glyph(cp, width, 0, 0, bitmaps[n], width)
+    return font
+
+
+def load_font(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:2] == b"\x36\x04" or data[:4] == b"\x72\xb5\x4a\x86":
+        return load_psf(path, data)
+    if data.startswith(b"STARTFONT"):
+        return load_bdf(path)
+    fail(path + ": not a BDF or PSF font")
+
+
+def crop(glyph):
+    """Trim empty rows and columns, moving the offsets to match."""
+    rows = glyph.rows
+    while rows and rows[0] == 0:
+        rows = rows[1:]
+        glyph.top += 1
+    while rows and rows[-1] == 0:
+        rows = rows[:-1]
+    if not rows:
+        glyph.rows, glyph.width, glyph.left, glyph.top = [], 0, 0, 0
+        return
+    ink = 0
+    for r in rows:
+        ink |= r
+    shift = (ink & -ink).bit_length() - 1
+    glyph.rows = [r >> shift for r in rows]
+    glyph.left += shift
+    glyph.width = (ink >> shift).bit_length()
+
+
+def label(glyph):
+    if glyph.codepoint < 0:
+        return "missing"
+    if 32 < glyph.codepoint < 127:
+        return "U+%04X %s" % (glyph.codepoint, chr(glyph.codepoint))
+    return "U+%04X" % glyph.codepoint
+
+
+def emit_font(out, name, path, font, first, last):
+    row_bytes = max([(font.glyphs[cp].width + 7) // 8 for cp in font.glyphs] + [1])
+    glyphs = [Glyph(-1, font.cell_width, 0, 0, [], 0)]
+    index = []
+    for cp in range(first, last + 1):
+        if cp in font.glyphs:
+            crop(font.glyphs[cp])
+            index.append(len(glyphs))
+            glyphs.append(font.glyphs[cp])
+        else:
+            index.append(0)
+
+    for g in glyphs:
+        if not (0 <= g.advance < 256 and -128 <= g.left < 128 and -128 <= g.top < 128 and len(g.rows) < 256):
+            fail("%s: glyph U+%04X does not fit the table fields" % (path, g.codepoint))
+
+    out.append("// %s: %dx%d cells, U+%04X..U+%04X" % (os.path.basename(path), font.cell_width,
+                                                    font.cell_height, first, last))
+    out.append("static const uint8_t %s_bitmap[] = {" % name)
+    offsets = []
+    offset = 0
+    for g in glyphs:
+        offsets.append(offset)
+        data = []
+        for r in g.rows:
+            data += list(r.to_bytes(row_bytes, "little"))
+        offset += len(data)
+        if data:
+            out.append("    " + ", ".join("0x%02X" % b for b in data) + ",  // " + label(g))
+    if offset == 0:
+        out.append("    0")
+    out.append("};")
+    out.append("")
+    if offset > 0xFFFF:
+        fail(path + ": bitmap table larger than 64K")
+
+    out.append("static const gfx_glyph_t %s_glyphs[] = {" % name)
+    for g, off in zip(glyphs, offsets):
+        out.append("    {%d, %d, %d, %d, %d, %d},  // %s" % (g.advance, g.left, g.top, g.width,
+                                                          len(g.rows), off, label(g)))
+    out.append("};")
+    out.append("")
+
+    out.append("static const uint16_t %s_index[] = {" % name)
+    for i in range(0, len(index), 16):
+        out.append("    " + ", ".join(str(v) for v in index[i:i + 16]) + ",")
+    out.append("};")
+    out.append("")
+
+    out.append("const gfx_font_t %s = {" % name)
+    title = os.path.splitext(os.path.basename(path))[0]
+    out.append("    \"%s\", %d, %d, %d, %d," % (title, font.cell_width, font.cell_height,
+                                                font.ascent, row_bytes))
+    out.append("    0x%04X, 0x%04X, %d," % (first, last, len(glyphs)))
+    out.append("    %s_index, %s_glyphs, %s_bitmap" % (name, name, name))
+    out.append("};")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert BDF/PSF fonts to gfx font tables")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--range", default="32-126", help="codepoints to index, FIRST-LAST")
+    parser.add_argument("fonts", nargs="+", metavar="NAME=FONT")
+    args = parser.parse_args()
+
+    first, last = (int(v, 0) for v in args.range.split("-"))
+    sources = []
+    for spec in args.fonts:
+        name, _, path = spec.partition("=")
+        if not name.isidentifier() or not path:
+            fail("expected NAME=FONT, got " + spec)
+        sources.append((name, path))
+
+    out = ["// Generated by tools/fontgen.py from %s; do not edit"
+           % ", ".join(path for _, path in sources),
+           "#include \"font.h\"",
+           ""]
+    for n, (name, path) in enumerate(sources):
+        if n:
+            out.append("")
+        emit_font(out, name, path, load_font(path), first, last)
+
+    text = "\n".join(out) + "\n"
+    if os.path.exists(args.output):
+        with open(args.output) as f:
+            if f.read() == text:
+                return
+    with open(args.output, "w") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()